@@ -0,0 +1,79 @@
+// Decode throughput of the texture loader's stb_image build (SSE2/NEON) against the same
+// decoder with SIMD disabled. Usage: texture_decode_bench [image...], default texture.jpg.
+// Reports megabytes of RGBA8 output per second.
+#include "..\VulkanStaticLib1\include\vulkanfiles.hpp"
+#include "..\VulkanStaticLib1\src\stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+unsigned char* referenceDecodeRGBA8(const unsigned char* data, int size, int* width, int* height);
+void referenceFree(unsigned char* pixels);
+
+namespace {
+    constexpr double MIN_SECONDS = 1.0;
+
+    // Decodes until MIN_SECONDS have passed, copying each result out the way the loader
+    // fills staging; returns output MB/s
+    template <typename Decode, typename Free>
+    double measure(const VulkanCube::MappedFile& file, std::vector<unsigned char>& staging,
+        Decode decode, Free release) {
+        auto* data = reinterpret_cast<const unsigned char*>(file.data());
+        const int size = static_cast<int>(file.size());
+
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed{};
+        do {
+            int width, height;
+            unsigned char* pixels = decode(data, size, &width, &height);
+            if (!pixels) {
+                throw std::runtime_error("Decode failed");
+            }
+            size_t pixelBytes = size_t(width) * height * 4;
+            staging.resize(std::max(staging.size(), pixelBytes));
+            std::memcpy(staging.data(), pixels, pixelBytes);
+            release(pixels);
+
+            bytes += pixelBytes;
+            elapsed = std::chrono::steady_clock::now() - start;
+        } while (elapsed.count() < MIN_SECONDS);
+        return bytes / elapsed.count() / (1024.0 * 1024.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths(argv + 1, argv + argc);
+    if (paths.empty()) {
+        paths.push_back("texture.jpg");
+    }
+
+    auto loaderDecode = [](const unsigned char* data, int size, int* width, int* height) {
+        int channels;
+        return stbi_load_from_memory(data, size, width, height, &channels, STBI_rgb_alpha);
+    };
+
+    try {
+        std::vector<unsigned char> staging;
+        for (const auto& path : paths) {
+            auto file = VulkanCube::MappedFile::open(path);
+            double reference = measure(file, staging, referenceDecodeRGBA8, referenceFree);
+            double loader = measure(file, staging, loaderDecode, stbi_image_free);
+
+            std::cout << path << ": scalar " << reference << " MB/s, loader " << loader
+                      << " MB/s (" << loader / reference << "x)" << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
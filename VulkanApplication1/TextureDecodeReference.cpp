@@ -0,0 +1,16 @@
+// stb_image built a second time with SIMD disabled, as the baseline for the decode
+// benchmark. STB_IMAGE_STATIC keeps this copy private to the file, so it cannot clash
+// with the library's build.
+#define STB_IMAGE_STATIC
+#define STBI_NO_SIMD
+#define STB_IMAGE_IMPLEMENTATION
+#include "..\VulkanStaticLib1\src\stb_image.h"
+
+unsigned char* referenceDecodeRGBA8(const unsigned char* data, int size, int* width, int* height) {
+    int channels;
+    return stbi_load_from_memory(data, size, width, height, &channels, STBI_rgb_alpha);
+}
+
+void referenceFree(unsigned char* pixels) {
+    stbi_image_free(pixels);
+}
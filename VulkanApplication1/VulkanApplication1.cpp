@@ -1,10 +1,16 @@
 #include "..\VulkanStaticLib1\framework.h"
+#include "..\VulkanStaticLib1\include\vulkanbindless.hpp"
 #include "..\VulkanStaticLib1\include\vulkanbuffers.hpp"
 #include "..\VulkanStaticLib1\include\vulkancore.hpp"
 #include "..\VulkanStaticLib1\include\vulkanpipeline.hpp"
+#include "..\VulkanStaticLib1\include\vulkanpipelinelibrary.hpp"
+#include "..\VulkanStaticLib1\include\vulkanpipelinemanifest.hpp"
 #include "..\VulkanStaticLib1\include\vulkantextures.hpp"
+#include "..\VulkanStaticLib1\include\vulkantexturecache.hpp"
 #include "..\VulkanStaticLib1\include\vulkancommands.hpp"
 #include "..\VulkanStaticLib1\include\vulkandescriptors.hpp"
+#include "..\VulkanStaticLib1\include\vulkanshaders.h"
+#include "..\VulkanStaticLib1\include\vulkanshaderreload.hpp"
 
 #include <GLFW/glfw3.h>
 
@@ -32,6 +38,12 @@ const std::vector<uint16_t> indices = {
     4, 0, 3, 3, 7, 4, 1, 5, 6, 6, 2, 1
 };
 
+// Pipelines used this session, replayed on the next launch (see vulkanpipelinemanifest.hpp)
+constexpr const char* PIPELINE_MANIFEST_PATH = "pipelines.manifest";
+
+// Decoded textures, so later launches skip the JPEG decode (see vulkantexturecache.hpp)
+constexpr const char* TEXTURE_CACHE_DIR = "texture_cache";
+
 class CubeApp {
 public:
     void run() {
@@ -45,12 +57,26 @@ private:
     GLFWwindow* window;
     VulkanCube::Context context;
     VulkanCube::CommandPool commandPool;
+    VulkanCube::PipelineStateCache pipelineStates;
+    std::unique_ptr<VulkanCube::PipelineCompiler> pipelineCompiler;
+    std::unique_ptr<VulkanCube::PipelineLibraryCache> pipelineLibrary;
+    VulkanCube::ShaderRegistry shaderRegistry;
+    VulkanCube::PipelineManifest pipelineManifest;
+    std::unique_ptr<VulkanCube::ShaderVariantCache> materialVariants;
+    VulkanCube::PipelineStateCache::Handle pipeline;
+    VulkanCube::PipelineLibraryCache::Linked linkedPipeline;    // Fast link `pipeline` started on
+    int fastLinkRetireFrames = 0;
+    std::unique_ptr<VulkanCube::ShaderReloader> shaderReloader;
     VulkanCube::Texture texture;
+    std::unique_ptr<VulkanCube::BindlessTextures> bindlessTextures;   // Null without descriptor indexing
     VulkanCube::BufferPackage vertexBuffer;
     VulkanCube::BufferPackage indexBuffer;
     VulkanCube::BufferPackage uniformBuffer;
+    std::unique_ptr<VulkanCube::DescriptorAllocator> descriptorAllocator;
     VulkanCube::DescriptorSets descriptorSets;
+    vk::DescriptorSet textureSet;       // Set 1: the bindless table, or the cube's texture alone
     VulkanCube::UniformBufferObject ubo{};
+    VulkanCube::PushConstants drawData{};
     bool framebufferResized = false;
 
     void initWindow() {
@@ -68,20 +94,96 @@ private:
 
     void initVulkan() {
         context = VulkanCube::Context::create(window, true);
-        commandPool = VulkanCube::CommandPool::create(context, 2);
-        texture = VulkanCube::Texture::loadFromFile(context, commandPool, "texture.jpg");
 
-        // Load shaders
-        auto vertShaderCode = VulkanCube::readFile("shader.vert.spv");
-        auto fragShaderCode = VulkanCube::readFile("shader.frag.spv");
+        // Warm up last session's pipelines on worker threads while the rest of init runs
+        shaderRegistry.add(VulkanShaders::vert_spv);
+        shaderRegistry.add(VulkanShaders::frag_spv);
+        shaderRegistry.add(VulkanShaders::frag_single_spv);
+        pipelineCompiler = std::make_unique<VulkanCube::PipelineCompiler>(context, pipelineStates);
+        {
+            VulkanCube::PipelineManifest previousSession;
+            if (previousSession.load(PIPELINE_MANIFEST_PATH)) {
+                size_t queued = previousSession.replay(*pipelineCompiler, shaderRegistry);
+                std::cout << "Pipeline warm-up: " << queued << " of " << previousSession.size()
+                    << " pipelines queued" << std::endl;
+            }
+        }
+        pipelineStates.setManifest(&pipelineManifest);
 
-        // Create pipeline with loaded shaders
-        context.createGraphicsPipeline(vertShaderCode, fragShaderCode);
+        commandPool = VulkanCube::CommandPool::create(context, 2);
+        VulkanCube::TextureDiskCache textureCache(TEXTURE_CACHE_DIR);
+        texture = VulkanCube::Texture::createFromUpload(context, commandPool,
+            textureCache.load(context, "texture.jpg"));
+
+        // Create pipeline from the embedded shaders; the model matrix travels as a push constant.
+        // Devices without descriptor indexing get the fragment shader that binds one texture.
+        VulkanCube::ShaderCode fragCode = context.descriptorIndexing
+            ? VulkanCube::ShaderCode(VulkanShaders::frag_spv)
+            : VulkanCube::ShaderCode(VulkanShaders::frag_single_spv);
+        auto pipelineDesc = VulkanCube::PipelineDesc::makeDefault(
+            context, VulkanShaders::vert_spv, fragCode);
+        pipelineDesc.pushConstantRanges = { VulkanCube::PushConstants::range() };
+        materialVariants = std::make_unique<VulkanCube::ShaderVariantCache>(
+            pipelineStates, pipelineDesc, std::vector<uint32_t>{ VulkanShaders::ALPHA_TEST });
+
+        // The cube texture is opaque, so it uses the variant with alpha testing compiled out
+        constexpr VulkanCube::ShaderVariantCache::Mask cubeFeatures = 0;
+        auto pipelineStart = std::chrono::high_resolution_clock::now();
+        if (context.graphicsPipelineLibrary) {
+            // Link existing library parts now; drawFrame moves to the optimized relink later
+            pipelineLibrary = std::make_unique<VulkanCube::PipelineLibraryCache>(context, *pipelineCompiler);
+            linkedPipeline = pipelineLibrary->get(materialVariants->describe(cubeFeatures));
+            pipeline = linkedPipeline.fast;
+        }
+        else {
+            pipeline = materialVariants->get(context, cubeFeatures);
+        }
+        auto pipelineTime = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - pipelineStart).count();
+        std::cout << "Pipeline creation: " << pipelineTime << " ms ("
+            << (context.pipelineCache.loadedFromDisk ? "warm" : "cold") << " cache"
+            << (pipelineLibrary ? ", fast link" : "") << ")" << std::endl;
+
+#ifdef VULKAN_CUBE_SHADER_DIR
+        // Edit shader.vert/shader.frag while the app runs; broken edits keep the old pipeline
+        shaderReloader = std::make_unique<VulkanCube::ShaderReloader>(
+            context, pipelineStates, VULKAN_CUBE_GLSLANG, [](const std::string& message) {
+                std::cerr << "Shader reload: " << message << std::endl;
+            });
+        shaderReloader->watch(pipeline, materialVariants->describe(cubeFeatures),
+            VULKAN_CUBE_SHADER_DIR "/shader.vert", context.descriptorIndexing
+                ? VULKAN_CUBE_SHADER_DIR "/shader.frag" : VULKAN_CUBE_SHADER_DIR "/shader_single.frag");
+#endif
 
         createVertexBuffer();
         createIndexBuffer();
         createUniformBuffer();
-        descriptorSets = VulkanCube::DescriptorSets::create(context, uniformBuffer, texture );
+        descriptorAllocator = std::make_unique<VulkanCube::DescriptorAllocator>(*context.device);
+        descriptorSets = VulkanCube::DescriptorSets::create(context, *descriptorAllocator, uniformBuffer);
+
+        if (context.descriptorIndexing) {
+            // The cube samples its texture out of the bindless table by material index
+            bindlessTextures = std::make_unique<VulkanCube::BindlessTextures>(context);
+            drawData.materialIndex = bindlessTextures->add(*texture.view, texture.sampler);
+            textureSet = bindlessTextures->set();
+        }
+        else {
+            // Set 1 holds just the cube's texture, as shader_single.frag declares it
+            vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, 1,
+                vk::ShaderStageFlagBits::eFragment);
+            textureSet = descriptorAllocator->allocate(
+                context.layoutCache->getDescriptorSetLayout({ &binding, 1 }));
+            vk::DescriptorImageInfo imageInfo(texture.sampler, *texture.view,
+                vk::ImageLayout::eShaderReadOnlyOptimal);
+            vk::WriteDescriptorSet write(textureSet, 0, 0, vk::DescriptorType::eCombinedImageSampler, imageInfo);
+            context.device->updateDescriptorSets(write, {});
+        }
+
+        // Nothing compiles on the critical path once the first frame starts. An optimized
+        // relink is left running: the fast link draws until it lands.
+        if (!pipelineLibrary) {
+            pipelineCompiler->waitIdle();
+        }
     }
 
     void createVertexBuffer() {
@@ -124,7 +226,8 @@ private:
         auto currentTime = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration<float>(currentTime - startTime).count();
 
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), { 0.0f, 0.0f, 1.0f });
+        drawData.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), { 0.0f, 0.0f, 1.0f });
+        ubo.model = glm::mat4(1.0f);
         ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
         ubo.proj = glm::perspective(
             glm::radians(45.0f),
@@ -144,6 +247,29 @@ private:
 
         auto& commandBuffer = commandPool.buffers[context.currentFrame].get();
 
+        // The frame that last used this slot must be done before its command buffer is reused
+        (void)context.device->waitForFences(*context.inFlightFences[context.currentFrame], VK_TRUE, UINT64_MAX);
+
+        // Frame boundary: swap in rebuilt shaders, free pipelines and texture slots no frame still uses
+        if (shaderReloader) {
+            shaderReloader->update();
+        }
+        if (bindlessTextures) {
+            bindlessTextures->update();
+        }
+
+        // Draw with the optimized relink once it lands, and drop the fast link after every
+        // frame that may have drawn with it has finished
+        if (linkedPipeline.fast) {
+            if (pipeline == linkedPipeline.fast) {
+                pipeline = linkedPipeline.current();
+            }
+            else if (++fastLinkRetireFrames > VulkanCube::Context::MAX_FRAMES_IN_FLIGHT) {
+                linkedPipeline = {};
+                pipelineLibrary->releaseFastLinked();
+            }
+        }
+
         vk::Result result;
         uint32_t imageIndex;
 
@@ -165,11 +291,12 @@ private:
             return;
         }
 
+        (void)context.device->resetFences(*context.inFlightFences[context.currentFrame]);
         commandBuffer.reset();
         commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
 
         vk::RenderPassBeginInfo renderPassInfo{
-            *context.renderPass,
+            pipeline->renderPass,
             *context.swapchainFramebuffers[imageIndex],
             {{0, 0}, context.swapchainExtent},
             1,
@@ -177,16 +304,18 @@ private:
         };
 
         commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *context.graphicsPipeline);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline->pipeline);
+        VulkanCube::setViewportAndScissor(commandBuffer, context.swapchainExtent);
         commandBuffer.bindVertexBuffers(0, { *vertexBuffer.buffer }, { 0 });
         commandBuffer.bindIndexBuffer(*indexBuffer.buffer, 0, vk::IndexType::eUint16);
         commandBuffer.bindDescriptorSets(
             vk::PipelineBindPoint::eGraphics,
-            *context.pipelineLayout,
+            pipeline->layout,
             0,
-            { *descriptorSets.sets[context.currentFrame] },
+            { descriptorSets.sets[context.currentFrame], textureSet },
             {}
         );
+        VulkanCube::pushConstants(commandBuffer, pipeline->layout, drawData);
         commandBuffer.drawIndexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
         commandBuffer.endRenderPass();
         commandBuffer.end();
@@ -243,18 +372,32 @@ private:
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
             drawFrame();
+            context.pipelineCache.saveIfDue(*context.device, std::chrono::minutes(5));
         }
         context.device->waitIdle();
     }
 
     void cleanup() {
         context.device->waitIdle();
+        context.pipelineCache.save(*context.device);
+        pipelineManifest.save(PIPELINE_MANIFEST_PATH);
 
         uniformBuffer = {};
         indexBuffer = {};
         vertexBuffer = {};
+        bindlessTextures.reset();
         texture = {};
         descriptorSets = {};
+        textureSet = nullptr;
+        descriptorAllocator.reset();
+        shaderReloader.reset();
+        pipeline = {};
+        linkedPipeline = {};
+        pipelineLibrary.reset();
+        materialVariants.reset();
+        pipelineCompiler.reset();
+        pipelineStates.setManifest(nullptr);
+        pipelineStates.clear();
         commandPool = {};
         context = {};
 
@@ -0,0 +1,45 @@
+# Turns a SPIR-V binary into a header holding its words as a constexpr std::array<uint32_t>,
+# so the shipped binary creates shader modules without touching the filesystem.
+#
+#   cmake -DINPUT=shader.vert.spv -DOUTPUT=vert_spv.h -DNAME=vert_spv -P EmbedSpirv.cmake
+#
+# Pass -DUNOPTIMIZED=<module> when INPUT went through spirv-opt to log the size saved.
+
+file(READ "${INPUT}" SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_WORD_COUNT "${SPIRV_HEX_LENGTH} / 8")
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if(SPIRV_WORD_COUNT EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a SPIR-V module")
+endif()
+
+get_filename_component(SPIRV_SOURCE "${INPUT}" NAME)
+if(DEFINED UNOPTIMIZED)
+    file(SIZE "${UNOPTIMIZED}" SPIRV_UNOPTIMIZED_SIZE)
+    math(EXPR SPIRV_SIZE "${SPIRV_WORD_COUNT} * 4")
+    math(EXPR SPIRV_PERCENT "${SPIRV_SIZE} * 100 / ${SPIRV_UNOPTIMIZED_SIZE}")
+    message(STATUS "${SPIRV_SOURCE}: ${SPIRV_UNOPTIMIZED_SIZE} -> ${SPIRV_SIZE} bytes (${SPIRV_PERCENT}%)")
+endif()
+
+# Words are stored little-endian in the file
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+    "0x\\4\\3\\2\\1," SPIRV_WORDS "${SPIRV_HEX}")
+# Eight words per line (CMake regexes have no {n} repetition)
+set(SPIRV_WORD_REGEX "0x[0-9a-f]+,")
+string(REPEAT "${SPIRV_WORD_REGEX}" 8 SPIRV_LINE_REGEX)
+string(REGEX REPLACE "(${SPIRV_LINE_REGEX})" "\\1\n        " SPIRV_WORDS "${SPIRV_WORDS}")
+string(STRIP "${SPIRV_WORDS}" SPIRV_WORDS)
+
+file(WRITE "${OUTPUT}"
+"// Generated from ${SPIRV_SOURCE} by EmbedSpirv.cmake. Do not edit.
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace VulkanShaders {
+    inline constexpr std::array<uint32_t, ${SPIRV_WORD_COUNT}> ${NAME} = {
+        ${SPIRV_WORDS}
+    };
+}
+")
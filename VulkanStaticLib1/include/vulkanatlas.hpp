@@ -0,0 +1,70 @@
+#pragma once
+
+#include "vulkantextures.hpp"
+
+#include <glm/glm.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace VulkanCube {
+    // Bottom-left skyline rectangle packer: tracks the top edge of everything placed so far
+    // and puts each rectangle where it ends up lowest. Good for many small images of
+    // mixed sizes, with no per-rectangle bookkeeping.
+    struct SkylinePacker {
+        SkylinePacker(uint32_t width, uint32_t height);
+
+        // Top-left corner of the placed rectangle, or empty if it no longer fits
+        std::optional<vk::Offset2D> insert(uint32_t width, uint32_t height);
+
+    private:
+        struct Segment {
+            uint32_t x;
+            uint32_t y;                 // Height of the skyline over [x, x + width)
+            uint32_t width;
+        };
+
+        uint32_t width;
+        uint32_t height;
+        std::vector<Segment> skyline;   // Left to right, covering the full width
+    };
+
+    // Packs small images (icons, decals) into the layers of one RGBA8 2D array texture, so
+    // they share an image, an allocation, a view and a descriptor. Images are added at load
+    // time, then build() uploads every layer at once. Shaders sample a region as
+    //
+    //     texture(atlas, vec3(region.uvOffset + uv * region.uvScale, region.layer))
+    //
+    // Each image gets a gutter of `padding` texels repeating its edges and sits on a
+    // padding-aligned grid, so neither filtering nor the log2(padding) mip levels below
+    // the base bleed into neighbours. The texture gets exactly those levels.
+    struct TextureAtlas {
+        struct Region {
+            uint32_t layer = 0;
+            glm::vec2 uvOffset{ 0.0f };
+            glm::vec2 uvScale{ 1.0f };
+        };
+
+        // padding must be a power of two (or 0 for a single-level atlas)
+        explicit TextureAtlas(uint32_t layerSize = 2048, uint32_t padding = 4);
+
+        // Return the index of the new region; throw if an image exceeds a whole layer
+        uint32_t add(const std::string& path);
+        uint32_t add(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+        const Region& region(uint32_t index) const { return regions[index]; }
+        uint32_t regionCount() const { return static_cast<uint32_t>(regions.size()); }
+        uint32_t layerCount() const { return static_cast<uint32_t>(layers.size()); }
+
+        // Viewed as e2DArray. The atlas keeps its pixels and can be built again after more adds.
+        Texture build(const Context& ctx, CommandPool& pool) const;
+
+    private:
+        uint32_t layerSize;
+        uint32_t padding;
+        std::vector<SkylinePacker> packers;             // One per layer
+        std::vector<std::vector<uint8_t>> layers;       // RGBA8 pixels
+        std::vector<Region> regions;
+    };
+}
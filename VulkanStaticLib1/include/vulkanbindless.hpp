@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vulkancore.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace VulkanCube {
+    // One descriptor set holding every texture as a combined image sampler, bound once per
+    // frame. Shaders declare the table as a runtime-sized array and pick a texture by index,
+    // typically PushConstants::materialIndex:
+    //
+    //     layout(set = 1, binding = 0) uniform sampler2D textures[];
+    //
+    // Switching materials is then just a different push constant. The layout comes from
+    // ctx.layoutCache with the same bindings reflection produces for that declaration, so it
+    // is the very handle pipelines use for the set. Requires Context::descriptorIndexing.
+    //
+    // Slots are written immediately and never disturb frames in flight; a removed slot is
+    // only handed out again once those frames have finished. Render thread only.
+    struct BindlessTextures {
+        using Index = uint32_t;
+
+        // stages must match the shaders that declare the table, or the layouts differ
+        BindlessTextures(const Context& ctx,
+            uint32_t capacity = LayoutCache::RUNTIME_ARRAY_CAPACITY,
+            vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eFragment);
+
+        BindlessTextures(const BindlessTextures&) = delete;
+        BindlessTextures& operator=(const BindlessTextures&) = delete;
+
+        // The view and sampler must outlive the slot and any frame that used it. Throws when
+        // every slot is taken.
+        Index add(vk::ImageView view, vk::Sampler sampler);
+
+        // Frames already recorded may still sample the slot; it stays reserved until they end
+        void remove(Index index);
+
+        // Render thread, once per frame after waiting on the frame's fence
+        void update();
+
+        vk::DescriptorSet set() const { return *descriptorSet; }
+        vk::DescriptorSetLayout layout() const { return setLayout; }
+        uint32_t capacity() const { return slotCount; }
+        uint32_t size() const { return used; }
+
+    private:
+        struct Retired {
+            Index index;
+            uint64_t releaseFrame;
+        };
+
+        const Context& ctx;
+        vk::DescriptorSetLayout setLayout;
+        vk::UniqueDescriptorPool pool;
+        vk::UniqueDescriptorSet descriptorSet;
+        uint32_t slotCount;
+        uint32_t used = 0;
+
+        Index nextUnused = 0;               // Slots past this have never been written
+        std::vector<Index> freeSlots;
+        std::deque<Retired> retired;
+        uint64_t frame = 0;
+    };
+}
@@ -4,6 +4,8 @@
 #include "vulkancore.hpp"
 #include "vulkanbuffers.hpp"
 
+#include <type_traits>
+
 namespace VulkanCube {
     // Forward declarations
     struct Context;             // Declared in vulkancore.hpp
@@ -16,17 +18,43 @@ namespace VulkanCube {
 
         static CommandPool create(const Context& ctx, uint32_t bufferCount);
 
-        void record(
+        void recordFrame(
             const Context& ctx,
             const GraphicsPipeline& pipeline,
             const BufferPackage& vertexBuffer,
             const BufferPackage& indexBuffer,
-            const std::vector<vk::UniqueFramebuffer>& framebuffers,
-            const std::vector<vk::UniqueDescriptorSet>& descriptorSets,
-            const std::vector<uint16_t>& indices
+            vk::Framebuffer framebuffer,
+            vk::DescriptorSet descriptorSet,
+            const std::vector<uint16_t>& indices,
+            const PushConstants& pushConstants,
+            uint32_t currentFrame
         ) const;
     };
 
+    // Pipelines use dynamic viewport and scissor; call after binding one, once per frame.
+    inline void setViewportAndScissor(vk::CommandBuffer cmdBuffer, vk::Extent2D extent) {
+        vk::Viewport viewport(0.0f, 0.0f,
+            static_cast<float>(extent.width), static_cast<float>(extent.height),
+            0.0f, 1.0f);
+        vk::Rect2D scissor({ 0, 0 }, extent);
+        cmdBuffer.setViewport(0, viewport);
+        cmdBuffer.setScissor(0, scissor);
+    }
+
+    // Typed wrapper around vkCmdPushConstants for small per-draw data.
+    template <typename T>
+    void pushConstants(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+        vk::ShaderStageFlags stages, const T& data, uint32_t offset = 0) {
+        static_assert(std::is_trivially_copyable_v<T>, "Push constant data must be trivially copyable");
+        static_assert(sizeof(T) <= 128, "Push constant data exceeds the guaranteed push constant size");
+        cmdBuffer.pushConstants(layout, stages, offset, sizeof(T), &data);
+    }
+
+    inline void pushConstants(vk::CommandBuffer cmdBuffer, vk::PipelineLayout layout,
+        const PushConstants& data) {
+        pushConstants(cmdBuffer, layout, PushConstants::stages, data);
+    }
+
     vk::UniqueCommandBuffer beginSingleTimeCommands(const Context& ctx, const CommandPool& pool);
     void endSingleTimeCommands(const Context& ctx, const CommandPool& pool, vk::CommandBuffer commandBuffer);
 }
\ No newline at end of file
@@ -6,8 +6,13 @@
 #define ENABLE_VALIDATION_LAYERS
 #include <vulkan/vulkan.hpp>
 
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <array>
 
@@ -24,11 +29,120 @@ namespace VulkanCube {
         std::vector<vk::PresentModeKHR> presentModes;
     };
 
+    // VkPipelineCache persisted to disk between runs. A saved blob is only fed back to the
+    // driver when its header matches this device's vendor, device and cache UUID.
+    struct PipelineCache {
+        vk::UniquePipelineCache cache;
+        std::string path;
+        bool loadedFromDisk = false;
+        std::chrono::steady_clock::time_point lastSave;
+
+        static PipelineCache create(vk::Device device,
+            const vk::PhysicalDeviceProperties& properties, const std::string& path);
+        static bool isCompatible(const std::vector<char>& data,
+            const vk::PhysicalDeviceProperties& properties);
+
+        bool save(vk::Device device);
+        bool saveIfDue(vk::Device device, std::chrono::seconds interval);
+    };
+
+    // Owns every descriptor set layout, pipeline layout and render pass, handing out one
+    // handle per distinct description. Pipelines borrow the handles, so equal layouts are
+    // created only once and stay compatible for descriptor binding across pipelines. Thread-safe.
+    struct LayoutCache {
+        explicit LayoutCache(vk::Device device);
+
+        LayoutCache(const LayoutCache&) = delete;
+        LayoutCache& operator=(const LayoutCache&) = delete;
+
+        // Upper bound for a runtime-sized array binding (descriptorCount 0, as reflected from
+        // `sampler2D textures[]`). Such a binding must be the set's last; it is created
+        // partially bound, update-after-bind and variable-count, which needs
+        // Context::descriptorIndexing. Well under the 500000 the spec guarantees.
+        static constexpr uint32_t RUNTIME_ARRAY_CAPACITY = 16384;
+
+        vk::DescriptorSetLayout getDescriptorSetLayout(
+            std::span<const vk::DescriptorSetLayoutBinding> bindings);
+        vk::PipelineLayout getPipelineLayout(
+            std::span<const vk::DescriptorSetLayout> setLayouts,
+            std::span<const vk::PushConstantRange> pushConstantRanges);
+
+        // The single-subpass color + depth pass every GraphicsPipeline renders in
+        vk::RenderPass getRenderPass(vk::Format colorFormat, vk::Format depthFormat);
+
+        size_t descriptorSetLayoutCount() const;
+        size_t pipelineLayoutCount() const;
+        size_t renderPassCount() const;
+
+    private:
+        struct SetLayoutKey {
+            std::vector<vk::DescriptorSetLayoutBinding> bindings;   // Sorted by binding
+            bool operator==(const SetLayoutKey& other) const = default;
+        };
+
+        struct PipelineLayoutKey {
+            std::vector<vk::DescriptorSetLayout> setLayouts;
+            std::vector<vk::PushConstantRange> pushConstantRanges;
+            bool operator==(const PipelineLayoutKey& other) const = default;
+        };
+
+        struct RenderPassKey {
+            vk::Format colorFormat;
+            vk::Format depthFormat;
+            bool operator==(const RenderPassKey& other) const = default;
+        };
+
+        struct KeyHash {
+            size_t operator()(const SetLayoutKey& key) const;
+            size_t operator()(const PipelineLayoutKey& key) const;
+            size_t operator()(const RenderPassKey& key) const;
+        };
+
+        vk::Device device;
+        mutable std::mutex mutex;
+        std::unordered_map<SetLayoutKey, vk::UniqueDescriptorSetLayout, KeyHash> setLayouts;
+        std::unordered_map<PipelineLayoutKey, vk::UniquePipelineLayout, KeyHash> pipelineLayouts;
+        std::unordered_map<RenderPassKey, vk::UniqueRenderPass, KeyHash> renderPasses;
+    };
+
+    // Shares one vk::Sampler among every user asking for the same state. Devices may cap
+    // live samplers as low as 4000, while thousands of textures need only a few distinct
+    // states. Samplers live until the cache is destroyed. Thread-safe.
+    struct SamplerCache {
+        explicit SamplerCache(vk::Device device);
+
+        SamplerCache(const SamplerCache&) = delete;
+        SamplerCache& operator=(const SamplerCache&) = delete;
+
+        // Keyed on every field but pNext, which must be null
+        vk::Sampler get(const vk::SamplerCreateInfo& info);
+
+        uint64_t hits() const;
+        size_t size() const;        // Live samplers
+
+    private:
+        struct KeyHash {
+            size_t operator()(const vk::SamplerCreateInfo& info) const;
+        };
+
+        vk::Device device;
+        mutable std::mutex mutex;
+        std::unordered_map<vk::SamplerCreateInfo, vk::UniqueSampler, KeyHash> samplers;
+        uint64_t hitCount = 0;
+    };
+
     struct Context {
         // Core members
         vk::UniqueInstance instance;
         vk::UniqueSurfaceKHR surface;
         vk::PhysicalDevice physicalDevice;
+        vk::PhysicalDeviceProperties deviceProperties;
+        vk::PhysicalDeviceFeatures deviceFeatures;
+        bool graphicsPipelineLibrary = false;       // VK_EXT_graphics_pipeline_library enabled
+        bool descriptorIndexing = false;            // Bindless features (see vulkanbindless.hpp) enabled
+        bool hostImageCopy = false;                 // VK_EXT_host_image_copy enabled (see Texture::createWithHostCopy)
+        PFN_vkTransitionImageLayoutEXT transitionImageLayoutEXT = nullptr;
+        PFN_vkCopyMemoryToImageEXT copyMemoryToImageEXT = nullptr;
         vk::UniqueDevice device;
         vk::Queue graphicsQueue;
         vk::Queue presentQueue;
@@ -48,6 +162,9 @@ namespace VulkanCube {
         uint32_t currentFrame = 0;
 
         // Pipeline
+        PipelineCache pipelineCache;
+        std::unique_ptr<LayoutCache> layoutCache;   // Heap-allocated so Context stays movable
+        std::unique_ptr<SamplerCache> samplerCache;
         vk::UniqueRenderPass renderPass;
         vk::UniquePipelineLayout pipelineLayout;
         vk::UniquePipeline graphicsPipeline;
@@ -57,6 +174,7 @@ namespace VulkanCube {
 
         // Constants
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+        static constexpr const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
         static const std::vector<const char*> deviceExtensions;
 
         static Context create(GLFWwindow* window, bool enableValidation = false);
@@ -3,14 +3,66 @@
 #include "vulkancore.hpp"
 #include "vulkanbuffers.hpp"
 
+#include <span>
+#include <vector>
+
 namespace VulkanCube {
+    // Hands out descriptor sets from a chain of pools. When a pool runs out
+    // (eErrorOutOfPoolMemory / eErrorFragmentedPool) the next one is opened, each twice the
+    // size of the last. Pools are created without eFreeDescriptorSet, which lets drivers
+    // allocate by bumping a pointer; sets are only ever released together by reset(),
+    // which keeps the pools for reuse.
+    //
+    // Pools hold every core descriptor type at fixed per-set ratios. Inline uniform blocks,
+    // extension types and update-after-bind layouts need a pool of their own (see
+    // BindlessTextures). Not thread-safe; give each thread its own.
+    struct DescriptorAllocator {
+        explicit DescriptorAllocator(vk::Device device, uint32_t initialSets = 64);
+
+        DescriptorAllocator(DescriptorAllocator&&) = default;
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        // Pass the layout's bindings to have a pool opened just for it when it needs more
+        // of one type than the ratios provide; without them such a layout throws
+        vk::DescriptorSet allocate(vk::DescriptorSetLayout layout,
+            std::span<const vk::DescriptorSetLayoutBinding> bindings = {});
+
+        // Every set allocated so far becomes invalid
+        void reset();
+
+        size_t poolCount() const { return usedPools.size() + freePools.size() + (current ? 1 : 0); }
+
+    private:
+        vk::UniqueDescriptorPool takePool();
+        vk::UniqueDescriptorPool createPool(std::span<const vk::DescriptorSetLayoutBinding> demand);
+
+        vk::Device device;
+        uint32_t nextPoolSets;
+        vk::UniqueDescriptorPool current;
+        std::vector<vk::UniqueDescriptorPool> usedPools;    // Full, waiting for reset()
+        std::vector<vk::UniqueDescriptorPool> freePools;    // Reset, ready to become current
+    };
+
+    // One allocator per frame in flight for sets that live a single frame; begin() resets
+    // the frame's allocator wholesale. Long-lived sets belong in a plain DescriptorAllocator.
+    struct FrameDescriptorAllocator {
+        explicit FrameDescriptorAllocator(vk::Device device);
+
+        // Render thread, after waiting on the frame's fence: that frame's sets are no
+        // longer in use
+        DescriptorAllocator& begin(uint32_t frameIndex);
+
+    private:
+        std::vector<DescriptorAllocator> frames;
+    };
+
     struct DescriptorSets {
-        std::vector<vk::UniqueDescriptorSet> sets;
-        vk::UniqueDescriptorPool pool;
-        vk::UniqueDescriptorSetLayout layout;
+        std::vector<vk::DescriptorSet> sets;        // One per frame in flight, owned by the allocator
+        vk::DescriptorSetLayout layout;             // Owned by ctx.layoutCache
 
-        static DescriptorSets create(const Context& ctx,
-            const BufferPackage& uniformBuffer,
-            const vk::ImageView& textureImageView);
+        // Set 0: the per-frame uniform buffer. Textures live in BindlessTextures (set 1).
+        static DescriptorSets create(const Context& ctx, DescriptorAllocator& allocator,
+            const BufferPackage& uniformBuffer);
     };
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vulkancore.hpp"
+#include "vulkanbuffers.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace VulkanCube {
+    // A texture rewritten every frame (video, procedural images) without stalling. Pixels
+    // go into a persistently mapped staging ring with one slice per frame in flight, so
+    // the CPU never waits for an earlier frame's copy; record() then copies the frame's
+    // updates into the image inside that frame's command buffer.
+    //
+    // There is one image, so the view and descriptor never change. The copy is ordered
+    // after the previous frame's sampling by a barrier on the GPU. A slice holds one full
+    // image, so any number of sub-rectangle updates fit as long as they add up to no
+    // more than that. Updates may overlap and apply in call order; each overlap costs
+    // record() an extra copy command and barrier. Uncompressed 4-byte formats only.
+    // Render thread only.
+    struct DynamicTexture {
+        DynamicTexture(const Context& ctx, uint32_t width, uint32_t height,
+            vk::Format format = vk::Format::eR8G8B8A8Srgb);
+
+        DynamicTexture(const DynamicTexture&) = delete;
+        DynamicTexture& operator=(const DynamicTexture&) = delete;
+
+        // Copies `rect` of the image from `pixels`, whose rows are `rowPitch` bytes apart
+        // (0 for tightly packed). Only between waiting on the frame's fence and record():
+        // the slice being written was last read by the frame that fence guards.
+        void update(const void* pixels, vk::Rect2D rect, size_t rowPitch = 0);
+
+        // Staging memory for `rect`, tightly packed rows, for decoders that can write in
+        // place; write-only, as it may be write-combined. Valid until record().
+        std::byte* write(vk::Rect2D rect);
+
+        // Once per frame after waiting on the frame's fence, outside a render pass. Leaves
+        // the image in eShaderReadOnlyOptimal; the first call clears it to transparent black.
+        void record(vk::CommandBuffer cmd);
+
+        vk::ImageView view() const { return *imageView; }
+        vk::Sampler sampler() const { return textureSampler; }
+        uint32_t width() const { return extent.width; }
+        uint32_t height() const { return extent.height; }
+
+    private:
+        const Context& ctx;
+        vk::Extent2D extent;
+        vk::Format format;
+        vk::UniqueImage image;
+        vk::UniqueDeviceMemory memory;
+        vk::UniqueImageView imageView;
+        vk::Sampler textureSampler;         // Owned by ctx.samplerCache
+
+        BufferPackage staging;              // MAX_FRAMES_IN_FLIGHT slices of sliceSize
+        vk::DeviceSize sliceSize;
+        vk::DeviceSize sliceUsed = 0;
+        uint32_t slice = 0;
+        std::vector<vk::BufferImageCopy> pending;
+        bool initialized = false;
+    };
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace VulkanCube {
+    // Read-only mapping of a whole file. Shader and image parsers read straight from the
+    // page cache instead of a heap copy. The mapping is page-aligned, so words() is always
+    // suitably aligned for vkCreateShaderModule. Move-only; unmapped on destruction.
+    struct MappedFile {
+        enum class Access {
+            Sequential,     // Parsed front to back once: read ahead aggressively
+            Random,         // Looked up piecemeal: read ahead only what is touched
+        };
+
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Throws std::runtime_error if the file cannot be opened or mapped
+        static MappedFile open(const std::string& path, Access access = Access::Sequential);
+
+        const std::byte* data() const { return static_cast<const std::byte*>(mapping); }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+
+        std::span<const std::byte> bytes() const { return { data(), length }; }
+
+        // Throws if the size is not a whole number of 32-bit words
+        std::span<const uint32_t> words() const;
+
+    private:
+        void unmap();
+
+        const void* mapping = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void* mappingHandle = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace VulkanCube {
+    // 64-bit FNV-1a. Unlike std::hash the result is stable from run to run, so it can key
+    // on-disk data as well as in-memory caches.
+    struct Hasher {
+        uint64_t state = 14695981039346656037ull;
+
+        Hasher& bytes(const void* data, size_t size) {
+            auto p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                state ^= p[i];
+                state *= 1099511628211ull;
+            }
+            return *this;
+        }
+
+        // Only feed scalars and enums here; structs may carry uninitialized padding
+        template <typename T>
+        Hasher& add(const T& value) {
+            static_assert(std::is_scalar_v<T>, "Hash struct members individually");
+            return bytes(&value, sizeof(T));
+        }
+
+        uint64_t value() const { return state; }
+    };
+
+    inline uint64_t hashBytes(const void* data, size_t size) {
+        return Hasher().bytes(data, size).value();
+    }
+}
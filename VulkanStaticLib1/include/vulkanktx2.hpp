@@ -0,0 +1,42 @@
+#pragma once
+
+#include "vulkancore.hpp"
+#include "vulkanfiles.hpp"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace VulkanCube {
+    // A KTX2 container holding a pre-built 2D mip chain, read straight from a file mapping.
+    // Only what the texture path uploads is accepted: one layer, one face, no
+    // supercompression and a concrete vkFormat (Basis Universal payloads are rejected).
+    struct Ktx2File {
+        struct Level {
+            size_t offset;      // Into the file
+            size_t length;
+        };
+
+        MappedFile file;
+        vk::Format format = vk::Format::eUndefined;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<Level> levels;      // Largest first
+
+        // Cheap check on the 12-byte identifier, for telling KTX2 apart from JPEG/PNG
+        static bool isKtx2(std::span<const std::byte> data);
+
+        // Throws std::runtime_error on a malformed or unsupported file
+        static Ktx2File open(const std::string& path);
+        static Ktx2File parse(MappedFile file, const std::string& path);
+
+        std::span<const std::byte> levelData(uint32_t level) const {
+            return file.bytes().subspan(levels[level].offset, levels[level].length);
+        }
+    };
+
+    // True if the device enabled the feature for format's compression family and can
+    // sample it in optimal tiling
+    bool isTextureFormatSupported(const Context& ctx, vk::Format format);
+}
@@ -2,15 +2,60 @@
 
 #include "../include/vulkanbuffers.hpp"
 #include "../include/vulkancore.hpp"
+#include "../include/vulkanfiles.hpp"
+#include "../include/vulkanreflection.hpp"
 #include "../include/vulkantextures.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include <array>
+#include <span>
 
 namespace VulkanCube {
 
+    struct PipelineManifest;
+
     std::vector<char> readFile(const std::string& filename);
 
+    // Reads a .spv into 32-bit words, so the code is correctly aligned for vkCreateShaderModule.
+    // Shipped shaders come embedded from vulkanshaders.h; this is for tools and development.
+    std::vector<uint32_t> readSpirvFile(const std::string& filename);
+
+    // Zero-copy variant: pass words() straight to createShaderModule or a PipelineDesc and
+    // keep the mapping alive for as long as the code is referenced
+    MappedFile mapSpirvFile(const std::string& filename);
+
+    // Non-owning view of SPIR-V words; the code must outlive every PipelineDesc that refers
+    // to it. Embedded shaders are static, so they always qualify. Compares by content.
+    struct ShaderCode {
+        std::span<const uint32_t> words;
+
+        ShaderCode() = default;
+        template <typename Range>
+            requires std::convertible_to<const Range&, std::span<const uint32_t>>
+        ShaderCode(const Range& code) : words(code) {}
+
+        // A temporary container would be freed before the desc is used
+        template <typename Range>
+            requires std::convertible_to<const Range&, std::span<const uint32_t>> &&
+                (!std::ranges::borrowed_range<Range>)
+        ShaderCode(Range&& code) = delete;
+
+        bool operator==(const ShaderCode& other) const {
+            return std::ranges::equal(words, other.words);
+        }
+    };
+
     struct Vertex {
         glm::vec3 pos;
         glm::vec2 texCoord;
@@ -19,18 +64,213 @@ namespace VulkanCube {
         static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions();
     };
 
+    // Per-draw data pushed straight into the command buffer instead of a uniform buffer.
+    // Must stay within the 128 bytes every implementation guarantees.
+    struct PushConstants {
+        alignas(16) glm::mat4 model;
+        uint32_t materialIndex = 0;
+
+        static constexpr vk::ShaderStageFlags stages =
+            vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+
+        static vk::PushConstantRange range() {
+            return { stages, 0, sizeof(PushConstants) };
+        }
+    };
+    static_assert(sizeof(PushConstants) <= 128, "PushConstants exceeds the guaranteed push constant size");
+
+    // Everything that makes one graphics pipeline differ from another. Equal descriptions
+    // compile to identical pipelines, which is what lets PipelineStateCache share them.
+    struct PipelineDesc {
+        // Shaders
+        ShaderCode vertCode;
+        ShaderCode fragCode;
+
+        // Vertex layout; left empty, the vertex shader's inputs are packed into binding 0
+        std::vector<vk::VertexInputBindingDescription> vertexBindings;
+        std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+
+        // Raster
+        vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+        vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+        vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+
+        // Depth
+        bool depthTest = true;
+        bool depthWrite = true;
+        vk::CompareOp depthCompare = vk::CompareOp::eLess;
+
+        // Blend
+        bool blendEnable = false;
+        vk::BlendFactor srcColorBlend = vk::BlendFactor::eSrcAlpha;
+        vk::BlendFactor dstColorBlend = vk::BlendFactor::eOneMinusSrcAlpha;
+        vk::BlendOp colorBlendOp = vk::BlendOp::eAdd;
+        vk::BlendFactor srcAlphaBlend = vk::BlendFactor::eOne;
+        vk::BlendFactor dstAlphaBlend = vk::BlendFactor::eZero;
+        vk::BlendOp alphaBlendOp = vk::BlendOp::eAdd;
+        vk::ColorComponentFlags colorWriteMask =
+            vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+            vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+        // Formats; viewport and scissor are dynamic state, so the extent is not part of the desc
+        vk::Format colorFormat = vk::Format::eUndefined;
+        vk::Format depthFormat = vk::Format::eUndefined;
+
+        // Empty means the ranges reflected from the shaders
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+
+        // Specialization constants, given to both stages; a stage ignores ids it does not
+        // declare. Fill through specialize() so entries and data stay consistent.
+        std::vector<vk::SpecializationMapEntry> specEntries;
+        std::vector<uint8_t> specData;
+
+        // Sets constant_id `id` to `value`; bools are stored as VkBool32 like the shader expects
+        template <typename T>
+            requires std::is_arithmetic_v<T>
+        PipelineDesc& specialize(uint32_t id, T value) {
+            if constexpr (std::is_same_v<T, bool>) {
+                return specialize(id, static_cast<vk::Bool32>(value));
+            }
+            else {
+                auto it = std::find_if(specEntries.begin(), specEntries.end(),
+                    [id](const vk::SpecializationMapEntry& e) { return e.constantID == id; });
+                if (it == specEntries.end()) {
+                    specEntries.push_back({ id, static_cast<uint32_t>(specData.size()), sizeof(T) });
+                    specData.resize(specData.size() + sizeof(T));
+                    it = specEntries.end() - 1;
+                }
+                else if (it->size != sizeof(T)) {
+                    throw std::runtime_error("Specialization constant respecialized with a different size");
+                }
+                std::memcpy(specData.data() + it->offset, &value, sizeof(T));
+                return *this;
+            }
+        }
+
+        // Swapchain formats and default fixed-function state; layouts come from reflection
+        static PipelineDesc makeDefault(const Context& ctx,
+            ShaderCode vertCode, ShaderCode fragCode);
+
+        uint64_t hash() const;
+        bool operator==(const PipelineDesc& other) const = default;
+    };
+
+    struct PipelineDescHash {
+        size_t operator()(const PipelineDesc& desc) const { return static_cast<size_t>(desc.hash()); }
+    };
+
     struct GraphicsPipeline {
-        vk::UniquePipelineLayout layout;
+        // Layouts and the render pass are owned by ctx.layoutCache and shared with every
+        // compatible pipeline
+        vk::PipelineLayout layout;
         vk::UniquePipeline pipeline;
-        vk::UniqueRenderPass renderPass;
-        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+        vk::RenderPass renderPass;
+        std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;  // Indexed by set number
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+        ShaderReflection reflection;
 
+        // Throws std::runtime_error if the driver rejects any object the pipeline needs
+        static GraphicsPipeline create(const Context& ctx, const PipelineDesc& desc);
         static GraphicsPipeline create(
             const Context& ctx,
-            const std::vector<char>& vertCode,
-            const std::vector<char>& fragCode
+            ShaderCode vertCode,
+            ShaderCode fragCode,
+            std::span<const vk::PushConstantRange> pushConstantRanges = {}
         );
     };
 
-    vk::UniqueShaderModule createShaderModule(vk::Device device, const std::vector<char>& code);
+    // A GraphicsPipeline whose render pass and layouts exist but whose vk::Pipeline has not
+    // been compiled yet. Owns everything `info` points at, so several builds can go to the
+    // driver in a single createGraphicsPipelines call.
+    struct PipelineBuild {
+        GraphicsPipeline pipeline;
+        vk::GraphicsPipelineCreateInfo info;
+
+        vk::UniqueShaderModule vertShader;
+        vk::UniqueShaderModule fragShader;
+        std::array<vk::PipelineShaderStageCreateInfo, 2> stages;
+        std::vector<vk::VertexInputBindingDescription> vertexBindings;
+        std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+        vk::PipelineVertexInputStateCreateInfo vertexInput;
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
+        vk::PipelineViewportStateCreateInfo viewportState;
+        vk::PipelineRasterizationStateCreateInfo rasterizer;
+        vk::PipelineMultisampleStateCreateInfo multisampling;
+        vk::PipelineDepthStencilStateCreateInfo depthStencil;
+        vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+        vk::PipelineColorBlendStateCreateInfo colorBlending;
+        std::array<vk::DynamicState, 2> dynamicStates;
+        vk::PipelineDynamicStateCreateInfo dynamicState;
+        std::vector<vk::SpecializationMapEntry> specEntries;
+        std::vector<uint8_t> specData;
+        vk::SpecializationInfo specialization;
+
+        // Heap-allocated because `info` holds pointers into the build itself
+        static std::unique_ptr<PipelineBuild> prepare(const Context& ctx, const PipelineDesc& desc);
+    };
+
+    // Hands out one shared GraphicsPipeline per distinct PipelineDesc. Safe to call from
+    // several threads; a description that is still compiling is waited on, not rebuilt.
+    struct PipelineStateCache {
+        using Handle = std::shared_ptr<const GraphicsPipeline>;
+
+        // A failed compile is rethrown and not cached, so the next call tries again
+        Handle getOrCreate(const Context& ctx, const PipelineDesc& desc);
+
+        // Returns the entry already registered for desc, or registers `pending` and sets
+        // `inserted`, in which case the caller must fulfil it or erase() the entry.
+        std::shared_future<Handle> lookupOrInsert(const PipelineDesc& desc,
+            std::shared_future<Handle> pending, bool& inserted);
+        void erase(const PipelineDesc& desc);
+        void clear();
+
+        // Logs every desc compiled from now on, so hits and failed builds are never written;
+        // null stops logging. The manifest must outlive the cache or be detached first.
+        void setManifest(PipelineManifest* manifest);
+        // Whoever fulfils an inserted entry calls this once the pipeline exists
+        void recordCompiled(const PipelineDesc& desc);
+
+        size_t size() const;
+        uint64_t hits() const { return hitCount; }
+        uint64_t misses() const { return missCount; }
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<PipelineDesc, std::shared_future<Handle>, PipelineDescHash> entries;
+        std::atomic<PipelineManifest*> manifest = nullptr;
+        std::atomic<uint64_t> hitCount = 0;
+        std::atomic<uint64_t> missCount = 0;
+    };
+
+    // Feature toggles of one shader pair, compiled on demand as specialization constants so
+    // the driver folds the disabled branches away. Bit i of a mask sets the bool constant
+    // featureIds[i]; every variant shares the same SPIR-V. Looking a mask up skips building
+    // and hashing a full PipelineDesc, so this is cheap enough to call per draw.
+    struct ShaderVariantCache {
+        using Handle = PipelineStateCache::Handle;
+        using Mask = uint32_t;
+
+        // Throws if a feature id is not a bool specialization constant in either shader
+        ShaderVariantCache(PipelineStateCache& states, PipelineDesc base, std::vector<uint32_t> featureIds);
+
+        ShaderVariantCache(const ShaderVariantCache&) = delete;
+        ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+
+        Handle get(const Context& ctx, Mask features);
+
+        // The desc a mask compiles to, e.g. for PipelineCompiler::compileAsync
+        PipelineDesc describe(Mask features) const;
+
+        size_t size() const;
+
+    private:
+        PipelineStateCache& states;
+        PipelineDesc base;
+        std::vector<uint32_t> featureIds;
+        mutable std::mutex mutex;
+        std::unordered_map<Mask, Handle> variants;
+    };
+
+    vk::UniqueShaderModule createShaderModule(vk::Device device, std::span<const uint32_t> code);
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vulkanpipeline.hpp"
+#include "vulkanworkers.hpp"
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+namespace VulkanCube {
+    // Compiles pipelines on background threads so a new material never stalls the frame.
+    // Requests that pile up while the workers are busy are handed to the driver together
+    // in one createGraphicsPipelines call. Results land in the shared PipelineStateCache,
+    // so an async request and a later getOrCreate for the same desc never compile twice.
+    struct PipelineCompiler {
+        using Handle = PipelineStateCache::Handle;
+        using Future = std::shared_future<Handle>;
+
+        static constexpr size_t MAX_BATCH_SIZE = 16;
+
+        PipelineCompiler(const Context& ctx, PipelineStateCache& cache, uint32_t threadCount = 0);
+        ~PipelineCompiler();
+
+        PipelineCompiler(const PipelineCompiler&) = delete;
+        PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+        Future compileAsync(const PipelineDesc& desc);
+
+        // Like compileAsync, but the pipeline for desc comes from `build` on a worker thread
+        // instead of a batched createGraphicsPipelines call
+        Future buildAsync(const PipelineDesc& desc, std::function<GraphicsPipeline()> build);
+
+        void waitIdle();
+
+        // Non-blocking: the compiled pipeline, or `fallback` (possibly null, meaning skip
+        // the draw) while it is still in flight or if compilation failed
+        static Handle readyOr(const Future& future, Handle fallback = nullptr);
+
+    private:
+        struct Request {
+            PipelineDesc desc;
+            std::promise<Handle> promise;
+        };
+
+        void compileBatch();
+        void fail(Request& request, std::exception_ptr error);
+
+        const Context& ctx;
+        PipelineStateCache& cache;
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Request>> pending;
+        WorkerPool workers;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vulkanpipeline.hpp"
+#include "vulkanpipelinecompiler.hpp"
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanCube {
+    // Pipelines assembled from VK_EXT_graphics_pipeline_library parts: vertex input,
+    // pre-rasterization shaders, fragment shader and fragment output. Each part is keyed by
+    // only the state it depends on, so a new combination usually compiles nothing and just
+    // links existing parts. The fast link skips link-time optimization; the optimized link
+    // runs on the PipelineCompiler and lands in its PipelineStateCache under the same desc.
+    // Only usable when ctx.graphicsPipelineLibrary is set.
+    struct PipelineLibraryCache {
+        using Handle = PipelineStateCache::Handle;
+
+        struct Linked {
+            Handle fast;                            // Usable immediately
+            PipelineCompiler::Future optimized;     // Replaces `fast` once ready
+
+            Handle current() const { return PipelineCompiler::readyOr(optimized, fast); }
+        };
+
+        PipelineLibraryCache(const Context& ctx, PipelineCompiler& compiler);
+        ~PipelineLibraryCache();
+
+        PipelineLibraryCache(const PipelineLibraryCache&) = delete;
+        PipelineLibraryCache& operator=(const PipelineLibraryCache&) = delete;
+
+        // Returns the optimized pipeline directly once the state cache has it
+        Linked get(const PipelineDesc& desc);
+
+        // Drops the fast-linked pipelines whose optimized version is ready
+        void releaseFastLinked();
+
+        size_t partCount() const;
+
+    private:
+        enum class Part : uint32_t {
+            VertexInput,
+            PreRasterization,
+            FragmentShader,
+            FragmentOutput,
+        };
+
+        // Only the state one part depends on; every other field of `state` keeps its default.
+        // The stage's SPIR-V is copied into `code`, since parts outlive the caller's desc.
+        struct PartKey {
+            Part part;
+            PipelineDesc state;
+            std::vector<uint32_t> code;
+            vk::PipelineLayout layout;
+
+            bool operator==(const PartKey& other) const = default;
+        };
+
+        struct PartKeyHash {
+            size_t operator()(const PartKey& key) const;
+        };
+
+        GraphicsPipeline link(const PipelineDesc& desc, bool optimize);
+        vk::Pipeline getPart(Part part, const PipelineDesc& desc, const PipelineBuild& build);
+
+        const Context& ctx;
+        PipelineCompiler& compiler;
+        mutable std::mutex mutex;
+        std::unordered_map<PartKey, vk::UniquePipeline, PartKeyHash> parts;
+        std::unordered_map<PipelineDesc, Linked, PipelineDescHash> fastLinked;
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "vulkanpipeline.hpp"
+#include "vulkanpipelinecompiler.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace VulkanCube {
+    // Shader code the app can hand back by content hash. A manifest stores only the hash of
+    // each module, so replay needs the same embedded shaders registered here.
+    struct ShaderRegistry {
+        static uint64_t key(ShaderCode code);
+
+        void add(ShaderCode code);
+
+        // Empty if no registered module has this hash
+        ShaderCode find(uint64_t hash) const;
+
+    private:
+        std::unordered_map<uint64_t, ShaderCode> shaders;
+    };
+
+    // Compact binary log of every PipelineDesc a session compiled through the PipelineStateCache.
+    // Saved on exit and replayed through a PipelineCompiler on the next launch, so pipelines
+    // are compiled on worker threads before the first frame instead of mid-game. The driver
+    // pipeline cache then makes those compiles cheap; this decides which ones to do at all.
+    struct PipelineManifest {
+        PipelineManifest() = default;
+
+        PipelineManifest(const PipelineManifest&) = delete;
+        PipelineManifest& operator=(const PipelineManifest&) = delete;
+
+        // Thread-safe; repeated descs are logged once
+        void record(const PipelineDesc& desc);
+
+        // Replaces the contents with a saved manifest. Returns false and stays empty if the
+        // file is missing, from another format version or corrupt.
+        bool load(const std::string& path);
+        bool save(const std::string& path) const;
+
+        // Queues every entry whose shaders are in `shaders` on the compiler and returns how
+        // many were queued. Entries naming unknown shaders (edited since) are skipped; use
+        // compiler.waitIdle() to block until the warm-up is done.
+        size_t replay(PipelineCompiler& compiler, const ShaderRegistry& shaders) const;
+
+        size_t size() const;
+
+    private:
+        struct Entry {
+            uint64_t key;                   // PipelineDesc::hash
+            std::vector<uint8_t> bytes;     // Serialized desc
+        };
+
+        mutable std::mutex mutex;
+        std::unordered_set<uint64_t> recorded;
+        std::vector<Entry> entries;         // In first-use order
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vulkancore.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace VulkanCube {
+    // Interface of a SPIR-V module read straight from its words: descriptor bindings,
+    // push-constant ranges, vertex/stage inputs and specialization constants. Pipelines
+    // build their layouts from this, so shaders are the single source of truth.
+    struct ShaderReflection {
+        struct DescriptorBinding {
+            uint32_t set = 0;
+            uint32_t binding = 0;
+            vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+            uint32_t count = 1;             // 0 for runtime-sized arrays
+            vk::ShaderStageFlags stages;
+        };
+
+        struct StageInput {
+            uint32_t location = 0;
+            vk::Format format = vk::Format::eUndefined;
+            uint32_t size = 0;              // Bytes, for packing vertex attributes
+        };
+
+        struct SpecConstant {
+            enum class Type { Bool, Int, UInt, Float };
+
+            uint32_t id = 0;
+            Type type = Type::UInt;
+            uint32_t defaultValue = 0;      // Raw bits of the shader's default
+            uint32_t size = 0;
+        };
+
+        vk::ShaderStageFlags stages;
+        std::vector<DescriptorBinding> bindings;            // Sorted by set, then binding
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+        std::vector<StageInput> inputs;                     // Sorted by location
+        std::vector<SpecConstant> specConstants;            // Sorted by id
+
+        // Throws std::runtime_error on malformed code
+        static ShaderReflection reflect(std::span<const uint32_t> code);
+
+        // Folds another stage in: shared bindings OR their stage flags, push constants collapse
+        // into one range. Inputs stay those of the first stage, i.e. the vertex shader.
+        void merge(const ShaderReflection& other);
+
+        uint32_t setCount() const;
+        std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings(uint32_t set) const;
+
+        // Inputs packed tightly, in location order, into one per-vertex binding
+        void vertexInput(std::vector<vk::VertexInputBindingDescription>& bindingDescs,
+            std::vector<vk::VertexInputAttributeDescription>& attributeDescs,
+            uint32_t binding = 0) const;
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "vulkanpipeline.hpp"
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanCube {
+    // Development aid: watches shader files and rebuilds the pipelines that use them while
+    // the app keeps running. GLSL is recompiled with `compiler`; .spv files are read as-is.
+    // Uses inotify on Linux and polls modification times elsewhere. Rebuilds happen on a
+    // background thread; update() installs them at a frame boundary and destroys replaced
+    // pipelines once MAX_FRAMES_IN_FLIGHT frames have passed.
+    struct ShaderReloader {
+        using Handle = PipelineStateCache::Handle;
+
+        // Receives compile and pipeline errors on the watcher thread; the slot keeps its
+        // current pipeline. Errors are dropped when no callback is given.
+        using ErrorCallback = std::function<void(const std::string& message)>;
+
+        ShaderReloader(const Context& ctx, PipelineStateCache& cache,
+            std::string compiler = "glslangValidator", ErrorCallback onError = {});
+        ~ShaderReloader();
+
+        ShaderReloader(const ShaderReloader&) = delete;
+        ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+        // Rebuilds `slot` from `desc` whenever either file changes; desc supplies everything
+        // but the shader code. `slot` must hold desc's pipeline and outlive the reloader.
+        void watch(Handle& slot, const PipelineDesc& desc,
+            const std::filesystem::path& vertPath, const std::filesystem::path& fragPath);
+
+        // Render thread, once per frame after waiting on the frame's fence.
+        // Returns true if any slot now holds a new pipeline.
+        bool update();
+
+    private:
+        using Code = std::shared_ptr<const std::vector<uint32_t>>;
+
+        // A desc together with the reloaded code its spans point into (null for code the
+        // caller owns), so the PipelineStateCache key stays valid until it is erased
+        struct Installed {
+            PipelineDesc desc;
+            Code vertCode;
+            Code fragCode;
+        };
+
+        struct Watch {
+            Handle* slot;
+            std::filesystem::path vertPath;
+            std::filesystem::path fragPath;
+            Installed latest;       // Newest code seen by the watcher thread
+            Installed installed;    // What *slot was built from; render thread only
+        };
+
+        struct Swap {
+            size_t watch;
+            Installed state;
+            Handle pipeline;
+        };
+
+        struct Retired {
+            Installed state;
+            Handle pipeline;
+            uint64_t releaseFrame;
+        };
+
+        void run();
+        void rebuild(const std::filesystem::path& changed);
+        Code compile(const std::filesystem::path& path) const;
+
+        const Context& ctx;
+        PipelineStateCache& cache;
+        std::string compiler;
+        ErrorCallback onError;
+
+        std::mutex mutex;
+        std::vector<Watch> watches;
+        std::vector<Swap> ready;
+        std::deque<Retired> retired;
+        uint64_t frame = 0;
+
+#ifdef __linux__
+        int inotifyFd = -1;
+        std::unordered_map<int, std::filesystem::path> directories;
+#else
+        std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+#endif
+        std::atomic<bool> stopping = false;
+        std::thread thread;
+    };
+}
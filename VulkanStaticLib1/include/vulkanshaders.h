@@ -1,19 +1,20 @@
 #pragma once
 
-#include <array>
+// SPIR-V for src/shader.vert, src/shader.frag and src/shader_single.frag. The build compiles
+// them with glslang and cmake/EmbedSpirv.cmake writes them out as constexpr word arrays:
+//   VulkanShaders::vert_spv, VulkanShaders::frag_spv, VulkanShaders::frag_single_spv
+// All convert to std::span<const uint32_t> for createShaderModule and PipelineDesc.
+// frag_single_spv samples one texture instead of the bindless table, for devices without
+// Context::descriptorIndexing.
+#include <cstdint>
 
-namespace VulkanShaders {
-    // vert.spv bytecode
-    constexpr std::array<uint32_t, 396> vert_spv = {
-        0x07230203,0x00010000,0x00080001,0x0000002e,0x00000000,0x00020011,0x00000001,0x0006000a,
-        0x5f565053,0x5f52484b,0x73796870,0x6c616369,0x00000000,0x0006000b,0x00000001,0x4c534c47,
-        /* ... full SPIR-V bytecode ... */
-    };
+#include "vert_spv.h"
+#include "frag_spv.h"
+#include "frag_single_spv.h"
 
-    // frag.spv bytecode
-    constexpr std::array<uint32_t, 276> frag_spv = {
-        0x07230203,0x00010000,0x00080001,0x0000001e,0x00000000,0x00020011,0x00000001,0x0006000a,
-        0x5f565053,0x5f52484b,0x73796870,0x6c616369,0x00000000,0x0006000b,0x00000001,0x4c534c47,
-        /* ... full SPIR-V bytecode ... */
+namespace VulkanShaders {
+    // constant_id values declared in both fragment shaders, for ShaderVariantCache feature lists
+    enum SpecConstant : uint32_t {
+        ALPHA_TEST = 0,
     };
-}
\ No newline at end of file
+}
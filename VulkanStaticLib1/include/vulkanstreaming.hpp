@@ -0,0 +1,107 @@
+#pragma once
+
+#include "vulkanbuffers.hpp"
+#include "vulkanktx2.hpp"
+#include "vulkantextures.hpp"
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanCube {
+    // Textures whose fine mips are only resident while something on screen needs them.
+    // A new texture first gets its small tail (levels no larger than TAIL_SIZE), so it can
+    // be drawn the frame it is added; finer levels stream in one per update as request()
+    // asks for them. When resident texel data exceeds the budget, the least recently
+    // requested textures drop their finest level again.
+    //
+    // A texture's image only ever holds its resident levels, so eviction really returns
+    // memory: moving the resident level reallocates the image and copies the kept levels
+    // over on the GPU. The view then starts at the resident level, which is the clamp a
+    // per-texture sampler minLod would otherwise provide. Render thread only.
+    struct TextureStreamer {
+        using Id = uint32_t;
+
+        static constexpr uint32_t TAIL_SIZE = 64;
+
+        // budgetBytes counts texel data of resident levels; uploadBytesPerUpdate caps how
+        // much new data one update() records
+        TextureStreamer(const Context& ctx, vk::DeviceSize budgetBytes,
+            vk::DeviceSize uploadBytesPerUpdate = 16ull << 20);
+
+        // The device must be idle; every image is destroyed immediately
+        ~TextureStreamer();
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        // KTX2 levels stream straight from the file mapping; other formats are decoded and
+        // mipmapped on the CPU once, with the chain kept in host memory
+        Id add(const std::string& path);
+        void remove(Id id);
+
+        // Marks the texture as drawn this frame covering about `screenPixels` pixels along
+        // its larger side; the finest level needed is derived from that
+        void request(Id id, float screenPixels);
+
+        // Once per frame, outside a render pass, into the frame's command buffer. Returns
+        // the textures whose view changed, whose descriptors must be rewritten.
+        std::vector<Id> update(vk::CommandBuffer cmd);
+
+        vk::ImageView view(Id id) const;
+        vk::Sampler sampler() const { return sharedSampler; }
+
+        uint32_t residentLevel(Id id) const;
+        vk::DeviceSize residentBytes() const { return resident; }
+
+    private:
+        struct Source {
+            std::optional<Ktx2File> ktx;
+            std::vector<std::vector<uint8_t>> rgbaLevels;
+            vk::Format format = vk::Format::eUndefined;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t levelCount = 0;
+
+            std::span<const std::byte> level(uint32_t level) const;
+            vk::DeviceSize bytesFrom(uint32_t level) const;
+        };
+
+        struct Resident {
+            vk::UniqueImage image;
+            vk::UniqueDeviceMemory memory;
+            vk::UniqueImageView view;
+        };
+
+        struct Entry {
+            Source source;
+            Resident image;             // Holds levels [base, levelCount)
+            uint32_t base = 0;          // Finest resident level; levelCount until first upload
+            uint32_t tail = 0;          // Coarsest level base may ever be evicted to
+            uint32_t wanted = 0;        // Finest level requested this frame
+            uint64_t lastUsed = 0;
+        };
+
+        struct Retired {
+            Resident image;
+            BufferPackage staging;
+            uint64_t releaseFrame;
+        };
+
+        // Moves entry's resident range to start at newBase, recording into cmd
+        void rebase(Entry& entry, uint32_t newBase, vk::CommandBuffer cmd);
+
+        const Context& ctx;
+        vk::Sampler sharedSampler;      // Owned by ctx.samplerCache
+        vk::DeviceSize budget;
+        vk::DeviceSize uploadPerUpdate;
+        vk::DeviceSize resident = 0;
+
+        std::unordered_map<Id, Entry> entries;
+        std::deque<Retired> retired;
+        Id nextId = 1;
+        uint64_t frame = 0;
+    };
+}
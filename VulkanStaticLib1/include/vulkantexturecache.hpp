@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vulkantextures.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+
+namespace VulkanCube {
+    // Decoded textures kept on disk in upload-ready layout, so later runs skip the image
+    // decoder entirely. Each source is stored as RGBA8 with its full CPU-built mip chain,
+    // named by a hash of the source bytes and LOADER_VERSION: editing the source or
+    // changing how textures are decoded simply misses and writes a fresh entry. A hit maps
+    // the entry and copies it into staging in one pass.
+    //
+    // KTX2 sources are already upload-ready and bypass the cache. Stale entries are never
+    // deleted; clearing the directory is always safe. Thread-safe.
+    struct TextureDiskCache {
+        // Bump whenever decoding or the mip filter changes the stored texels
+        static constexpr uint32_t LOADER_VERSION = 1;
+
+        // The directory is created on first write
+        explicit TextureDiskCache(std::filesystem::path directory);
+
+        TextureDiskCache(const TextureDiskCache&) = delete;
+        TextureDiskCache& operator=(const TextureDiskCache&) = delete;
+
+        // Same results as TextureUpload::fromFile. A missing or unreadable cache entry
+        // falls back to decoding; failing to write one is ignored.
+        TextureUpload load(const Context& ctx, const std::string& path);
+
+        uint64_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+        uint64_t misses() const { return missCount.load(std::memory_order_relaxed); }
+
+    private:
+        std::filesystem::path directory;
+        std::atomic<uint64_t> hitCount{ 0 };
+        std::atomic<uint64_t> missCount{ 0 };
+    };
+}
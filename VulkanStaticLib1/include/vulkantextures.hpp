@@ -1,17 +1,102 @@
 #pragma once
 
 #include "vulkancore.hpp"
+#include "vulkanbuffers.hpp"
 #include "vulkancommands.hpp"
+#include "vulkanworkers.hpp"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace VulkanCube {
     struct CommandPool;
+    struct Ktx2File;
+
+    // Trilinear, repeating, anisotropic where enabled; fetch it from ctx.samplerCache
+    vk::SamplerCreateInfo textureSamplerInfo(const Context& ctx);
+
+    // True if the GPU can generate format's mips with linear blits
+    bool supportsMipBlits(const Context& ctx, vk::Format format);
+
+    // Levels in a full mip chain down to 1x1
+    uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+    // Next mip level of tightly packed RGBA8 pixels with a 2x2 box filter (SSE2/NEON);
+    // dst holds max(w/2,1) x max(h/2,1) pixels
+    void downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst);
+
+    // The CPU half of a texture upload: pixels decoded (or KTX2 levels copied) into staging
+    // memory, plus the copy regions that go with it. Safe to build on worker threads;
+    // Texture::recordUpload turns it into an image on the thread that owns the command pool.
+    struct TextureUpload {
+        BufferPackage staging;
+        std::vector<vk::BufferImageCopy> regions;
+        vk::Format format = vk::Format::eUndefined;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 1;
+        uint32_t layers = 1;        // Regions address layers through imageSubresource
+        vk::ImageViewType viewType = vk::ImageViewType::e2D;
+        bool blitMips = false;      // Levels past regions are blitted from level 0 on the GPU
+
+        // Same format rules as Texture::loadFromFile
+        static TextureUpload fromFile(const Context& ctx, const std::string& path);
+        static TextureUpload fromPixels(const Context& ctx,
+            const uint8_t* rgba, uint32_t width, uint32_t height);
+        static TextureUpload fromKtx2(const Context& ctx, const Ktx2File& ktx);
+    };
 
     struct Texture {
         vk::UniqueImage image;
         vk::UniqueDeviceMemory memory;
         vk::UniqueImageView view;
-        vk::UniqueSampler sampler;
+        vk::Sampler sampler;        // Owned by ctx.samplerCache
+        vk::Format format = vk::Format::eUndefined;
+        uint32_t mipLevels = 1;
+        uint32_t layers = 1;
 
+        // KTX2 files upload their stored format and mips as-is; anything else is decoded by
+        // stb_image to RGBA8. Throws if a KTX2 format is not supported by the device.
         static Texture loadFromFile(const Context& ctx, CommandPool& pool, const char* path);
+
+        // Loads the first candidate the device can sample, e.g. { "x.bc7.ktx2",
+        // "x.astc.ktx2", "x.etc2.ktx2", "x.png" }; a non-KTX2 file always qualifies and
+        // candidates that cannot be opened are skipped
+        static Texture loadFirstSupported(const Context& ctx, CommandPool& pool,
+            std::span<const std::string> candidates);
+
+        static Texture createFromKtx2(const Context& ctx, CommandPool& pool, const Ktx2File& ktx);
+
+        // Uploads tightly packed RGBA8 sRGB pixels with a full mip chain, blitted on the GPU
+        // when the format supports linear blits and box-filtered on the CPU otherwise
+        static Texture createFromPixels(const Context& ctx, CommandPool& pool,
+            const uint8_t* rgba, uint32_t width, uint32_t height);
+
+        // Decodes every path concurrently on `workers` and uploads each group of finished
+        // decodes while the rest are still running. Results follow the order of `paths`;
+        // if any file fails, the first error is rethrown once all jobs have finished.
+        static std::vector<Texture> loadBatch(const Context& ctx, CommandPool& pool,
+            WorkerPool& workers, std::span<const std::string> paths);
+
+        // Writes `levels` (largest first, tightly packed) into a new optimal-tiled image
+        // straight from host memory with VK_EXT_host_image_copy: no staging buffer and no
+        // queue submission, so any thread may call it. Requires supportsHostCopy(ctx, format).
+        // loadFromFile, createFromKtx2 and loadBatch take this path for textures up to 16 MiB.
+        static Texture createWithHostCopy(const Context& ctx, vk::Format format,
+            uint32_t width, uint32_t height, std::span<const std::span<const std::byte>> levels);
+
+        // False as well when the device reports that host-transfer images of format lose
+        // optimal device access (VkHostImageCopyDevicePerformanceQueryEXT)
+        static bool supportsHostCopy(const Context& ctx, vk::Format format);
+
+        // Records and submits the upload, then waits for it
+        static Texture createFromUpload(const Context& ctx, CommandPool& pool, const TextureUpload& upload);
+
+        // Records the copies (and mip blits) for `upload` into cmdBuffer. The staging memory
+        // must stay alive until cmdBuffer has finished executing.
+        static Texture recordUpload(const Context& ctx, vk::CommandBuffer cmdBuffer,
+            const TextureUpload& upload);
     };
 } // namespace VulkanCube
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VulkanCube {
+    // Fixed set of background threads draining a FIFO of jobs. Jobs still queued when the
+    // pool is destroyed are run before the threads are joined. Jobs must not throw.
+    struct WorkerPool {
+        explicit WorkerPool(uint32_t threadCount = 0);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void submit(std::function<void()> job);
+        void waitIdle();
+
+        size_t threadCount() const { return threads.size(); }
+
+    private:
+        void run();
+
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable jobAvailable;
+        std::condition_variable idle;
+        uint32_t activeJobs = 0;
+        bool stopping = false;
+    };
+}
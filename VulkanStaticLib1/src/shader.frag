@@ -1,10 +1,24 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 layout(location = 0) in vec2 fragTexCoord;
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Every texture, selected per draw by materialIndex (see vulkanbindless.hpp)
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint materialIndex;
+} pc;
+
+// Variant toggles; the driver folds the disabled paths away
+layout(constant_id = 0) const bool ALPHA_TEST = false;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    vec4 color = texture(textures[pc.materialIndex], fragTexCoord);
+    if (ALPHA_TEST && color.a < 0.5) {
+        discard;
+    }
+    outColor = color;
 }
\ No newline at end of file
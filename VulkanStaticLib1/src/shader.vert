@@ -8,9 +8,14 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint materialIndex;
+} pc;
+
 layout(location = 0) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * pc.model * vec4(inPosition, 1.0);
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 450
+layout(location = 0) in vec2 fragTexCoord;
+
+// Fallback for devices without descriptor indexing: one texture bound per draw in place of
+// shader.frag's bindless table
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
+
+// Variant toggles; the driver folds the disabled paths away
+layout(constant_id = 0) const bool ALPHA_TEST = false;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 color = texture(texSampler, fragTexCoord);
+    if (ALPHA_TEST && color.a < 0.5) {
+        discard;
+    }
+    outColor = color;
+}
@@ -0,0 +1,212 @@
+#include "../pch.h"
+#include "../include/vulkanatlas.hpp"
+#include "../include/vulkanfiles.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    SkylinePacker::SkylinePacker(uint32_t width, uint32_t height)
+        : width(width), height(height), skyline{ { 0, 0, width } } {
+    }
+
+    std::optional<vk::Offset2D> SkylinePacker::insert(uint32_t rectWidth, uint32_t rectHeight) {
+        if (rectWidth == 0 || rectHeight == 0 || rectWidth > width || rectHeight > height) {
+            return std::nullopt;
+        }
+
+        // Try the rectangle's left edge at the start of every segment; it rests on the
+        // highest segment beneath it. Lowest wins, then the narrowest starting segment.
+        size_t best = skyline.size();
+        uint32_t bestY = height;
+        uint32_t bestWidth = width + 1;
+        for (size_t i = 0; i < skyline.size(); i++) {
+            uint32_t x = skyline[i].x;
+            if (x + rectWidth > width) {
+                break;
+            }
+            uint32_t y = 0;
+            for (size_t j = i; j < skyline.size() && skyline[j].x < x + rectWidth; j++) {
+                y = std::max(y, skyline[j].y);
+            }
+            if (y + rectHeight > height) {
+                continue;
+            }
+            if (y < bestY || (y == bestY && skyline[i].width < bestWidth)) {
+                best = i;
+                bestY = y;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (best == skyline.size()) {
+            return std::nullopt;
+        }
+
+        // The rectangle's top replaces the skyline over its span
+        const uint32_t x = skyline[best].x;
+        const uint32_t right = x + rectWidth;
+        while (best < skyline.size() && skyline[best].x < right) {
+            uint32_t end = skyline[best].x + skyline[best].width;
+            if (end > right) {
+                skyline[best].x = right;
+                skyline[best].width = end - right;
+                break;
+            }
+            skyline.erase(skyline.begin() + best);
+        }
+        skyline.insert(skyline.begin() + best, Segment{ x, bestY + rectHeight, rectWidth });
+
+        for (size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else {
+                i++;
+            }
+        }
+        return vk::Offset2D{ static_cast<int32_t>(x), static_cast<int32_t>(bestY) };
+    }
+
+    TextureAtlas::TextureAtlas(uint32_t layerSize, uint32_t padding)
+        : layerSize(layerSize), padding(padding) {
+        if (padding != 0 && !std::has_single_bit(padding)) {
+            throw std::runtime_error("Texture atlas padding must be a power of two");
+        }
+    }
+
+    uint32_t TextureAtlas::add(const std::string& path) {
+        MappedFile file = MappedFile::open(path);
+        int texWidth, texHeight, texChannels;
+        stbi_uc* pixels = stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+            &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load texture image: " + path);
+        }
+
+        uint32_t index;
+        try {
+            index = add(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+        }
+        catch (...) {
+            stbi_image_free(pixels);
+            throw;
+        }
+        stbi_image_free(pixels);
+        return index;
+    }
+
+    uint32_t TextureAtlas::add(const uint8_t* rgba, uint32_t width, uint32_t height) {
+        // Sizes rounded to the padding keep every placement on the alignment grid
+        const uint32_t align = std::max(padding, 1u);
+        const uint32_t paddedWidth = (width + 2 * padding + align - 1) / align * align;
+        const uint32_t paddedHeight = (height + 2 * padding + align - 1) / align * align;
+        if (width == 0 || height == 0 || paddedWidth > layerSize || paddedHeight > layerSize) {
+            throw std::runtime_error("Image does not fit in a texture atlas layer");
+        }
+
+        // First layer with room, else a new one
+        std::optional<vk::Offset2D> at;
+        uint32_t layer = 0;
+        for (; layer < packers.size() && !at; layer++) {
+            at = packers[layer].insert(paddedWidth, paddedHeight);
+        }
+        if (at) {
+            layer--;
+        }
+        else {
+            packers.emplace_back(layerSize, layerSize);
+            layers.emplace_back(size_t(layerSize) * layerSize * 4);
+            at = packers.back().insert(paddedWidth, paddedHeight);
+        }
+
+        // Copy the image in, repeating its outermost texels across the gutter
+        const auto x0 = static_cast<uint32_t>(at->x);
+        const auto y0 = static_cast<uint32_t>(at->y);
+        uint8_t* pixels = layers[layer].data();
+        for (uint32_t row = 0; row < paddedHeight; row++) {
+            uint32_t srcRow = std::min(row > padding ? row - padding : 0u, height - 1);
+            const uint8_t* src = rgba + size_t(srcRow) * width * 4;
+            uint8_t* out = pixels + (size_t(y0 + row) * layerSize + x0) * 4;
+            for (uint32_t col = 0; col < padding; col++) {
+                memcpy(out + size_t(col) * 4, src, 4);
+            }
+            memcpy(out + size_t(padding) * 4, src, size_t(width) * 4);
+            for (uint32_t col = padding + width; col < paddedWidth; col++) {
+                memcpy(out + size_t(col) * 4, src + size_t(width - 1) * 4, 4);
+            }
+        }
+
+        const float scale = 1.0f / static_cast<float>(layerSize);
+        Region region;
+        region.layer = layer;
+        region.uvOffset = glm::vec2(float(x0 + padding), float(y0 + padding)) * scale;
+        region.uvScale = glm::vec2(float(width), float(height)) * scale;
+        regions.push_back(region);
+        return static_cast<uint32_t>(regions.size() - 1);
+    }
+
+    Texture TextureAtlas::build(const Context& ctx, CommandPool& pool) const {
+        if (layers.empty()) {
+            throw std::runtime_error("Texture atlas has no images");
+        }
+
+        TextureUpload upload;
+        upload.format = vk::Format::eR8G8B8A8Srgb;
+        upload.width = layerSize;
+        upload.height = layerSize;
+        upload.layers = layerCount();
+        upload.viewType = vk::ImageViewType::e2DArray;
+        upload.mipLevels = std::min(static_cast<uint32_t>(std::bit_width(padding)), mipLevelCount(layerSize, layerSize));
+        upload.mipLevels = std::max(upload.mipLevels, 1u);
+        upload.blitMips = upload.mipLevels > 1 && supportsMipBlits(ctx, upload.format);
+        const uint32_t uploadLevels = upload.blitMips ? 1 : upload.mipLevels;
+
+        // Staging layout: each layer's levels in turn
+        vk::DeviceSize stagingSize = 0;
+        for (uint32_t layer = 0; layer < upload.layers; layer++) {
+            for (uint32_t level = 0; level < uploadLevels; level++) {
+                uint32_t size = std::max(layerSize >> level, 1u);
+                upload.regions.emplace_back(
+                    stagingSize, 0, 0,
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, layer, 1),
+                    vk::Offset3D{ 0, 0, 0 },
+                    vk::Extent3D{ size, size, 1 });
+                stagingSize += vk::DeviceSize(size) * size * 4;
+            }
+        }
+
+        upload.staging = BufferPackage::create(
+            ctx, stagingSize,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+
+        // CPU levels are filtered in host memory; staging is write-only
+        auto* mapped = static_cast<uint8_t*>(upload.staging.mapped);
+        std::vector<uint8_t> previous, current;
+        for (uint32_t layer = 0; layer < upload.layers; layer++) {
+            const auto& base = upload.regions[size_t(layer) * uploadLevels];
+            memcpy(mapped + base.bufferOffset, layers[layer].data(), layers[layer].size());
+
+            const uint8_t* src = layers[layer].data();
+            for (uint32_t level = 1; level < uploadLevels; level++) {
+                const auto& region = upload.regions[size_t(layer) * uploadLevels + level];
+                current.resize(size_t(region.imageExtent.width) * region.imageExtent.height * 4);
+                uint32_t srcSize = std::max(layerSize >> (level - 1), 1u);
+                downsampleRGBA8(src, srcSize, srcSize, current.data());
+                memcpy(mapped + region.bufferOffset, current.data(), current.size());
+                previous.swap(current);
+                src = previous.data();
+            }
+        }
+
+        return Texture::createFromUpload(ctx, pool, upload);
+    }
+} // namespace VulkanCube
@@ -0,0 +1,75 @@
+#include "../pch.h"
+#include "../include/vulkanbindless.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    BindlessTextures::BindlessTextures(const Context& ctx, uint32_t capacity, vk::ShaderStageFlags stages)
+        : ctx(ctx), slotCount(std::min(capacity, LayoutCache::RUNTIME_ARRAY_CAPACITY)) {
+        if (!ctx.descriptorIndexing) {
+            throw std::runtime_error("Bindless textures need descriptor indexing, which this device lacks");
+        }
+
+        // Count 0 is how reflection describes `sampler2D textures[]`
+        vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, 0, stages);
+        setLayout = ctx.layoutCache->getDescriptorSetLayout({ &binding, 1 });
+
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, slotCount);
+        vk::DescriptorPoolCreateInfo poolInfo(
+            vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind |
+            vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+            1, poolSize);
+        auto poolResult = ctx.device->createDescriptorPoolUnique(poolInfo);
+        if (poolResult.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create bindless descriptor pool!");
+        }
+        pool = std::move(poolResult.value);
+
+        // Only the requested capacity is allocated out of the layout's upper bound
+        vk::DescriptorSetVariableDescriptorCountAllocateInfo countInfo(slotCount);
+        vk::DescriptorSetAllocateInfo allocInfo(*pool, setLayout);
+        allocInfo.pNext = &countInfo;
+        auto setResult = ctx.device->allocateDescriptorSetsUnique(allocInfo);
+        if (setResult.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to allocate bindless descriptor set!");
+        }
+        descriptorSet = std::move(setResult.value.front());
+    }
+
+    BindlessTextures::Index BindlessTextures::add(vk::ImageView view, vk::Sampler sampler) {
+        Index index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else if (nextUnused < slotCount) {
+            index = nextUnused++;
+        }
+        else {
+            throw std::runtime_error("Bindless texture table is full");
+        }
+
+        // Update-after-bind lets this land while earlier frames still use other slots
+        vk::DescriptorImageInfo imageInfo(sampler, view, vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::WriteDescriptorSet write(*descriptorSet, 0, index, vk::DescriptorType::eCombinedImageSampler, imageInfo);
+        ctx.device->updateDescriptorSets(write, {});
+        used++;
+        return index;
+    }
+
+    void BindlessTextures::remove(Index index) {
+        // Partially bound: the stale descriptor is harmless as long as nothing indexes it
+        retired.push_back({ index, frame + Context::MAX_FRAMES_IN_FLIGHT });
+        used--;
+    }
+
+    void BindlessTextures::update() {
+        frame++;
+        while (!retired.empty() && retired.front().releaseFrame <= frame) {
+            freeSlots.push_back(retired.front().index);
+            retired.pop_front();
+        }
+    }
+} // namespace VulkanCube
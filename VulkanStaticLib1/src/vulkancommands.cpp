@@ -32,9 +32,10 @@ namespace VulkanCube {
         vk::Framebuffer framebuffer,
         vk::DescriptorSet descriptorSet,
         const std::vector<uint16_t>& indices,
+        const PushConstants& pushConstants,
         uint32_t currentFrame
     ) const {
-        auto& cmdBuffer = buffers[currentFrame];
+        vk::CommandBuffer cmdBuffer = *buffers[currentFrame];
 
         cmdBuffer.reset();
         vk::CommandBufferBeginInfo beginInfo;
@@ -46,7 +47,7 @@ namespace VulkanCube {
         } };
 
         vk::RenderPassBeginInfo renderPassInfo(
-            *pipeline.renderPass,
+            pipeline.renderPass,
             framebuffer,
             vk::Rect2D({ 0, 0 }, ctx.swapchainExtent),
             clearValues.size(), clearValues.data()
@@ -54,15 +55,17 @@ namespace VulkanCube {
 
         cmdBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
         cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline.pipeline);
+        setViewportAndScissor(cmdBuffer, ctx.swapchainExtent);
 
         cmdBuffer.bindVertexBuffers(0, { *vertexBuffer.buffer }, { 0 });
         cmdBuffer.bindIndexBuffer(*indexBuffer.buffer, 0, vk::IndexType::eUint16);
 
         cmdBuffer.bindDescriptorSets(
             vk::PipelineBindPoint::eGraphics,
-            *pipeline.layout,
+            pipeline.layout,
             0, { descriptorSet }, {}
         );
+        VulkanCube::pushConstants(cmdBuffer, pipeline.layout, pushConstants);
 
         cmdBuffer.drawIndexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
         cmdBuffer.endRenderPass();
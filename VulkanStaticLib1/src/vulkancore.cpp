@@ -1,6 +1,8 @@
 #include "..\pch.h"
 #include "..\include\vulkancore.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <set>
 #include <stdexcept>
 
@@ -109,6 +111,7 @@ namespace VulkanCube {
                 break;
             }
         }
+        ctx.deviceProperties = ctx.physicalDevice.getProperties();
 
         // Device creation
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
@@ -125,15 +128,118 @@ namespace VulkanCube {
         vk::PhysicalDeviceFeatures deviceFeatures;
         deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+        // Block-compressed texture families; KTX2 loading picks whichever is enabled here
+        vk::PhysicalDeviceFeatures supportedFeatures = ctx.physicalDevice.getFeatures();
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+        deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+        // Optional extensions, enabled only when the device supports them
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        auto available = ctx.physicalDevice.enumerateDeviceExtensionProperties().value;
+        auto hasExtension = [&available](const char* name) {
+            return std::any_of(available.begin(), available.end(),
+                [name](const vk::ExtensionProperties& e) { return std::strcmp(e.extensionName, name) == 0; });
+        };
+
+        vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures;
+        if (hasExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+            hasExtension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+            auto supported = ctx.physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+            if (supported.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary) {
+                enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+                enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+                libraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+                ctx.graphicsPipelineLibrary = true;
+            }
+        }
+
+        // Descriptor indexing is core in 1.2; older devices may expose it as an extension
+        vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures;
+        const bool indexingCore = ctx.deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+        if (indexingCore || hasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+            auto supported = ctx.physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                vk::PhysicalDeviceDescriptorIndexingFeatures>().get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+            if (supported.runtimeDescriptorArray && supported.descriptorBindingPartiallyBound &&
+                supported.descriptorBindingVariableDescriptorCount &&
+                supported.descriptorBindingSampledImageUpdateAfterBind &&
+                supported.descriptorBindingUpdateUnusedWhilePending) {
+                if (!indexingCore) {
+                    enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+                }
+                indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+                indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+                indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+                indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+                indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+                indexingFeatures.shaderSampledImageArrayNonUniformIndexing =
+                    supported.shaderSampledImageArrayNonUniformIndexing;
+                ctx.descriptorIndexing = true;
+            }
+        }
+
+        // Host image copy lets worker threads write textures without staging or a queue
+        // submission; only worth it when images can be written in the layout shaders read
+        vk::PhysicalDeviceHostImageCopyFeaturesEXT hostCopyFeatures;
+        if (ctx.deviceProperties.apiVersion >= VK_API_VERSION_1_3 &&
+            hasExtension(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME)) {
+            auto supported = ctx.physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                vk::PhysicalDeviceHostImageCopyFeaturesEXT>();
+
+            // The layout lists are two-call: counts first, then the layouts themselves
+            vk::StructureChain<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceHostImageCopyPropertiesEXT> properties;
+            ctx.physicalDevice.getProperties2(&properties.get<vk::PhysicalDeviceProperties2>());
+            auto& hostCopyProperties = properties.get<vk::PhysicalDeviceHostImageCopyPropertiesEXT>();
+            std::vector<vk::ImageLayout> dstLayouts(hostCopyProperties.copyDstLayoutCount);
+            hostCopyProperties.pCopyDstLayouts = dstLayouts.data();
+            ctx.physicalDevice.getProperties2(&properties.get<vk::PhysicalDeviceProperties2>());
+
+            bool writesShaderLayout = std::find(dstLayouts.begin(), dstLayouts.end(),
+                vk::ImageLayout::eShaderReadOnlyOptimal) != dstLayouts.end();
+            if (supported.get<vk::PhysicalDeviceHostImageCopyFeaturesEXT>().hostImageCopy && writesShaderLayout) {
+                enabledExtensions.push_back(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+                hostCopyFeatures.hostImageCopy = VK_TRUE;
+                ctx.hostImageCopy = true;
+            }
+        }
+
         vk::DeviceCreateInfo deviceInfo({},
             static_cast<uint32_t>(queueCreateInfos.size()), queueCreateInfos.data(),
             0, nullptr,
-            static_cast<uint32_t>(deviceExtensions.size()), deviceExtensions.data(),
+            static_cast<uint32_t>(enabledExtensions.size()), enabledExtensions.data(),
             &deviceFeatures);
+        if (ctx.graphicsPipelineLibrary) {
+            libraryFeatures.pNext = const_cast<void*>(deviceInfo.pNext);
+            deviceInfo.pNext = &libraryFeatures;
+        }
+        if (ctx.descriptorIndexing) {
+            indexingFeatures.pNext = const_cast<void*>(deviceInfo.pNext);
+            deviceInfo.pNext = &indexingFeatures;
+        }
+        if (ctx.hostImageCopy) {
+            hostCopyFeatures.pNext = const_cast<void*>(deviceInfo.pNext);
+            deviceInfo.pNext = &hostCopyFeatures;
+        }
 
         ctx.device = ctx.physicalDevice.createDeviceUnique(deviceInfo).value;
         ctx.graphicsQueue = ctx.device->getQueue(ctx.queueIndices.graphicsFamily.value(), 0);
         ctx.presentQueue = ctx.device->getQueue(ctx.queueIndices.presentFamily.value(), 0);
+        ctx.deviceFeatures = deviceFeatures;
+        if (ctx.hostImageCopy) {
+            // Extension commands are not exported by the loader
+            ctx.transitionImageLayoutEXT = reinterpret_cast<PFN_vkTransitionImageLayoutEXT>(
+                ctx.device->getProcAddr("vkTransitionImageLayoutEXT"));
+            ctx.copyMemoryToImageEXT = reinterpret_cast<PFN_vkCopyMemoryToImageEXT>(
+                ctx.device->getProcAddr("vkCopyMemoryToImageEXT"));
+        }
+
+        // Pipeline cache, warm from the previous run when the saved blob matches this device
+        ctx.pipelineCache = PipelineCache::create(*ctx.device, ctx.deviceProperties, PIPELINE_CACHE_FILE);
+
+        // Descriptor set and pipeline layouts, shared by every pipeline built on this device
+        ctx.layoutCache = std::make_unique<LayoutCache>(*ctx.device);
+        ctx.samplerCache = std::make_unique<SamplerCache>(*ctx.device);
 
         // Swapchain creation
         SwapChainSupportDetails swapChainSupport = ctx.querySwapChainSupport();
@@ -0,0 +1,149 @@
+#include "../pch.h"
+#include "../include/vulkandescriptors.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    // Descriptors of each type a pool provides per set it can hold; every core type that
+    // needs no extra pool create info
+    struct PoolRatio {
+        vk::DescriptorType type;
+        uint32_t perSet;
+    };
+    static constexpr std::array<PoolRatio, 11> POOL_RATIOS = { {
+        { vk::DescriptorType::eSampler, 1 },
+        { vk::DescriptorType::eCombinedImageSampler, 4 },
+        { vk::DescriptorType::eSampledImage, 2 },
+        { vk::DescriptorType::eStorageImage, 1 },
+        { vk::DescriptorType::eUniformTexelBuffer, 1 },
+        { vk::DescriptorType::eStorageTexelBuffer, 1 },
+        { vk::DescriptorType::eUniformBuffer, 2 },
+        { vk::DescriptorType::eStorageBuffer, 2 },
+        { vk::DescriptorType::eUniformBufferDynamic, 1 },
+        { vk::DescriptorType::eStorageBufferDynamic, 1 },
+        { vk::DescriptorType::eInputAttachment, 1 },
+    } };
+
+    static constexpr uint32_t MAX_POOL_SETS = 4096;
+
+    static bool isPoolFull(vk::Result result) {
+        return result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool;
+    }
+
+    DescriptorAllocator::DescriptorAllocator(vk::Device device, uint32_t initialSets)
+        : device(device), nextPoolSets(std::max(initialSets, 1u)) {
+    }
+
+    vk::UniqueDescriptorPool DescriptorAllocator::takePool() {
+        if (!freePools.empty()) {
+            auto pool = std::move(freePools.back());
+            freePools.pop_back();
+            return pool;
+        }
+        return createPool({});
+    }
+
+    vk::UniqueDescriptorPool DescriptorAllocator::createPool(
+        std::span<const vk::DescriptorSetLayoutBinding> demand) {
+        std::array<vk::DescriptorPoolSize, POOL_RATIOS.size()> sizes;
+        for (size_t i = 0; i < POOL_RATIOS.size(); i++) {
+            sizes[i] = vk::DescriptorPoolSize(POOL_RATIOS[i].type, POOL_RATIOS[i].perSet * nextPoolSets);
+        }
+
+        // Room for at least one set of `demand`, however far it exceeds the ratios
+        for (size_t i = 0; i < sizes.size(); i++) {
+            uint32_t needed = 0;
+            for (const auto& binding : demand) {
+                if (binding.descriptorType == sizes[i].type) {
+                    needed += binding.descriptorCount;
+                }
+            }
+            sizes[i].descriptorCount = std::max(sizes[i].descriptorCount, needed);
+        }
+
+        vk::DescriptorPoolCreateInfo poolInfo({}, nextPoolSets, sizes);
+        auto result = device.createDescriptorPoolUnique(poolInfo);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create descriptor pool!");
+        }
+        nextPoolSets = std::min(nextPoolSets * 2, MAX_POOL_SETS);
+        return std::move(result.value);
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout,
+        std::span<const vk::DescriptorSetLayoutBinding> bindings) {
+        if (!current) {
+            current = takePool();
+        }
+
+        vk::DescriptorSet set;
+        vk::DescriptorSetAllocateInfo allocInfo(*current, layout);
+        vk::Result result = device.allocateDescriptorSets(&allocInfo, &set);
+        if (isPoolFull(result)) {
+            // Retire the exhausted pool and try again in the next one
+            usedPools.push_back(std::move(current));
+            current = takePool();
+            allocInfo.descriptorPool = *current;
+            result = device.allocateDescriptorSets(&allocInfo, &set);
+        }
+        if (isPoolFull(result)) {
+            // Even an empty pool was too small for this layout; open one sized for it
+            usedPools.push_back(std::move(current));
+            current = createPool(bindings);
+            allocInfo.descriptorPool = *current;
+            result = device.allocateDescriptorSets(&allocInfo, &set);
+        }
+        if (isPoolFull(result)) {
+            throw std::runtime_error("Descriptor set layout needs more descriptors than a pool holds; "
+                "pass its bindings to DescriptorAllocator::allocate");
+        }
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to allocate descriptor set!");
+        }
+        return set;
+    }
+
+    void DescriptorAllocator::reset() {
+        if (current) {
+            usedPools.push_back(std::move(current));
+        }
+        for (auto& pool : usedPools) {
+            device.resetDescriptorPool(*pool);
+            freePools.push_back(std::move(pool));
+        }
+        usedPools.clear();
+    }
+
+    FrameDescriptorAllocator::FrameDescriptorAllocator(vk::Device device) {
+        for (int i = 0; i < Context::MAX_FRAMES_IN_FLIGHT; i++) {
+            frames.emplace_back(device);
+        }
+    }
+
+    DescriptorAllocator& FrameDescriptorAllocator::begin(uint32_t frameIndex) {
+        DescriptorAllocator& allocator = frames[frameIndex % frames.size()];
+        allocator.reset();
+        return allocator;
+    }
+
+    DescriptorSets DescriptorSets::create(const Context& ctx, DescriptorAllocator& allocator,
+        const BufferPackage& uniformBuffer) {
+        // Same binding reflection derives from shader.vert, so the layout is the pipeline's
+        DescriptorSets ds;
+        vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eUniformBuffer, 1,
+            vk::ShaderStageFlagBits::eVertex);
+        ds.layout = ctx.layoutCache->getDescriptorSetLayout({ &binding, 1 });
+
+        vk::DescriptorBufferInfo bufferInfo(*uniformBuffer.buffer, 0, sizeof(UniformBufferObject));
+        for (int i = 0; i < Context::MAX_FRAMES_IN_FLIGHT; i++) {
+            vk::DescriptorSet set = allocator.allocate(ds.layout, { &binding, 1 });
+            vk::WriteDescriptorSet write(set, 0, 0, vk::DescriptorType::eUniformBuffer, {}, bufferInfo);
+            ctx.device->updateDescriptorSets(write, {});
+            ds.sets.push_back(set);
+        }
+        return ds;
+    }
+} // namespace VulkanCube
@@ -0,0 +1,206 @@
+#include "../pch.h"
+#include "../include/vulkandynamictexture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    static constexpr vk::DeviceSize TEXEL_SIZE = 4;
+
+    static bool overlaps(const vk::BufferImageCopy& a, const vk::BufferImageCopy& b) {
+        return a.imageOffset.x < b.imageOffset.x + static_cast<int32_t>(b.imageExtent.width) &&
+            b.imageOffset.x < a.imageOffset.x + static_cast<int32_t>(a.imageExtent.width) &&
+            a.imageOffset.y < b.imageOffset.y + static_cast<int32_t>(b.imageExtent.height) &&
+            b.imageOffset.y < a.imageOffset.y + static_cast<int32_t>(a.imageExtent.height);
+    }
+
+    static bool isFourByteFormat(vk::Format format) {
+        switch (format) {
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eA2B10G10R10UnormPack32:
+        case vk::Format::eR32Sfloat:
+        case vk::Format::eR32Uint:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    DynamicTexture::DynamicTexture(const Context& ctx, uint32_t width, uint32_t height, vk::Format format)
+        : ctx(ctx), extent{ width, height }, format(format),
+          sliceSize(vk::DeviceSize(width) * height * TEXEL_SIZE) {
+        if (!isFourByteFormat(format) || width == 0 || height == 0) {
+            throw std::runtime_error("DynamicTexture needs a non-empty image in a 4-byte texel format");
+        }
+
+        vk::ImageCreateInfo imageInfo(
+            {}, vk::ImageType::e2D, format,
+            { width, height, 1 },
+            1, 1, vk::SampleCountFlagBits::e1,
+            vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
+        );
+        image = ctx.device->createImageUnique(imageInfo).value;
+
+        vk::MemoryRequirements memRequirements = ctx.device->getImageMemoryRequirements(*image);
+        vk::MemoryAllocateInfo allocInfo(
+            memRequirements.size,
+            findMemoryType(ctx.physicalDevice, memRequirements.memoryTypeBits,
+                vk::MemoryPropertyFlagBits::eDeviceLocal)
+        );
+        memory = ctx.device->allocateMemoryUnique(allocInfo).value;
+        ctx.device->bindImageMemory(*image, *memory, 0);
+
+        vk::ImageViewCreateInfo viewInfo(
+            {}, *image, vk::ImageViewType::e2D, format,
+            {}, { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
+        );
+        imageView = ctx.device->createImageViewUnique(viewInfo).value;
+
+        // Frames are shown 1:1, so no mips and no wrapping at the edges
+        vk::SamplerCreateInfo samplerInfo(
+            {},
+            vk::Filter::eLinear,
+            vk::Filter::eLinear,
+            vk::SamplerMipmapMode::eNearest,
+            vk::SamplerAddressMode::eClampToEdge,
+            vk::SamplerAddressMode::eClampToEdge,
+            vk::SamplerAddressMode::eClampToEdge,
+            0.0f,
+            VK_FALSE,
+            1.0f,
+            VK_FALSE,
+            vk::CompareOp::eAlways,
+            0.0f,
+            0.0f,
+            vk::BorderColor::eIntOpaqueBlack,
+            VK_FALSE
+        );
+        textureSampler = ctx.samplerCache->get(samplerInfo);
+
+        staging = BufferPackage::create(
+            ctx, sliceSize * Context::MAX_FRAMES_IN_FLIGHT,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+    }
+
+    std::byte* DynamicTexture::write(vk::Rect2D rect) {
+        if (rect.offset.x < 0 || rect.offset.y < 0 || rect.extent.width == 0 || rect.extent.height == 0 ||
+            rect.offset.x + rect.extent.width > extent.width ||
+            rect.offset.y + rect.extent.height > extent.height) {
+            throw std::runtime_error("DynamicTexture update outside the image");
+        }
+
+        vk::DeviceSize bytes = vk::DeviceSize(rect.extent.width) * rect.extent.height * TEXEL_SIZE;
+        if (sliceUsed + bytes > sliceSize) {
+            throw std::runtime_error("DynamicTexture updates exceed one image per frame");
+        }
+
+        // Offsets stay multiples of the texel size, as copies require
+        vk::DeviceSize offset = slice * sliceSize + sliceUsed;
+        sliceUsed += bytes;
+        pending.emplace_back(
+            offset, 0, 0,
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+            vk::Offset3D{ rect.offset.x, rect.offset.y, 0 },
+            vk::Extent3D{ rect.extent.width, rect.extent.height, 1 });
+        return static_cast<std::byte*>(staging.mapped) + offset;
+    }
+
+    void DynamicTexture::update(const void* pixels, vk::Rect2D rect, size_t rowPitch) {
+        const size_t rowBytes = size_t(rect.extent.width) * TEXEL_SIZE;
+        if (rowPitch == 0) {
+            rowPitch = rowBytes;
+        }
+
+        std::byte* dst = write(rect);
+        auto* src = static_cast<const std::byte*>(pixels);
+        if (rowPitch == rowBytes) {
+            memcpy(dst, src, rowBytes * rect.extent.height);
+            return;
+        }
+        for (uint32_t row = 0; row < rect.extent.height; row++) {
+            memcpy(dst + row * rowBytes, src + row * rowPitch, rowBytes);
+        }
+    }
+
+    void DynamicTexture::record(vk::CommandBuffer cmd) {
+        const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+        if (!initialized || !pending.empty()) {
+            // The previous frame's sampling must finish before the copy overwrites texels;
+            // the first time there is nothing to wait for and no contents to keep
+            vk::ImageMemoryBarrier toTransfer(
+                {}, vk::AccessFlagBits::eTransferWrite,
+                initialized ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eTransferDstOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                *image, range
+            );
+            cmd.pipelineBarrier(
+                initialized ? vk::PipelineStageFlagBits::eFragmentShader : vk::PipelineStageFlagBits::eTopOfPipe,
+                vk::PipelineStageFlagBits::eTransfer,
+                {}, {}, {}, toTransfer
+            );
+
+            bool cleared = false;
+            if (!initialized) {
+                cmd.clearColorImage(*image, vk::ImageLayout::eTransferDstOptimal,
+                    vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f }), range);
+                initialized = true;
+                cleared = true;
+            }
+
+            // Regions of one copy must not overlap, so an update overlapping an earlier one
+            // starts a new copy, ordered after the previous by a barrier so it lands on top.
+            // The first copy is ordered after the clear the same way.
+            size_t first = 0;
+            while (first < pending.size()) {
+                size_t end = first + 1;
+                while (end < pending.size() && std::none_of(pending.begin() + first, pending.begin() + end,
+                    [&](const vk::BufferImageCopy& region) { return overlaps(region, pending[end]); })) {
+                    end++;
+                }
+                if (first > 0 || cleared) {
+                    vk::ImageMemoryBarrier afterCopy(
+                        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite,
+                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferDstOptimal,
+                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                        *image, range
+                    );
+                    cmd.pipelineBarrier(
+                        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                        {}, {}, {}, afterCopy
+                    );
+                }
+                cmd.copyBufferToImage(*staging.buffer, *image, vk::ImageLayout::eTransferDstOptimal,
+                    vk::ArrayProxy<const vk::BufferImageCopy>(static_cast<uint32_t>(end - first), &pending[first]));
+                first = end;
+            }
+
+            vk::ImageMemoryBarrier toShader(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                *image, range
+            );
+            cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eFragmentShader,
+                {}, {}, {}, toShader
+            );
+        }
+
+        // Next frame writes the next slice; the one after reuses this slice only once the
+        // caller has waited on this frame's fence
+        pending.clear();
+        sliceUsed = 0;
+        slice = (slice + 1) % Context::MAX_FRAMES_IN_FLIGHT;
+    }
+} // namespace VulkanCube
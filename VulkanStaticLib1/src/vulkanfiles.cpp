@@ -0,0 +1,151 @@
+#include "../pch.h"
+#include "../include/vulkanfiles.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanCube {
+
+    MappedFile::~MappedFile() {
+        unmap();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : mapping(std::exchange(other.mapping, nullptr)),
+          length(std::exchange(other.length, 0))
+#ifdef _WIN32
+        , mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+    {
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            mapping = std::exchange(other.mapping, nullptr);
+            length = std::exchange(other.length, 0);
+#ifdef _WIN32
+            mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    std::span<const uint32_t> MappedFile::words() const {
+        if (length % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("Mapped file is not a whole number of 32-bit words");
+        }
+        return { static_cast<const uint32_t*>(mapping), length / sizeof(uint32_t) };
+    }
+
+#ifdef _WIN32
+    MappedFile MappedFile::open(const std::string& path, Access access) {
+        DWORD hint = access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | hint, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to stat file: " + path);
+        }
+
+        MappedFile mapped;
+        if (fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return mapped;
+        }
+
+        // The mapping object keeps the file open, so the file handle can go right away
+        HANDLE section = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!section) {
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+
+        const void* view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(section);
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+
+        mapped.mapping = view;
+        mapped.length = static_cast<size_t>(fileSize.QuadPart);
+        mapped.mappingHandle = section;
+        return mapped;
+    }
+
+    void MappedFile::unmap() {
+        if (mapping) {
+            UnmapViewOfFile(mapping);
+            CloseHandle(mappingHandle);
+        }
+        mapping = nullptr;
+        mappingHandle = nullptr;
+        length = 0;
+    }
+#else
+    MappedFile MappedFile::open(const std::string& path, Access access) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to stat file: " + path);
+        }
+
+        MappedFile mapped;
+        if (info.st_size == 0) {
+            close(fd);
+            return mapped;
+        }
+
+        // The mapping holds its own reference to the file, so the descriptor can go right away
+        size_t size = static_cast<size_t>(info.st_size);
+        void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED) {
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+
+        // Hints only; a kernel that ignores them still gives a correct mapping
+        madvise(view, size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        if (access == Access::Sequential) {
+            madvise(view, size, MADV_WILLNEED);
+        }
+
+        mapped.mapping = view;
+        mapped.length = size;
+        return mapped;
+    }
+
+    void MappedFile::unmap() {
+        if (mapping) {
+            munmap(const_cast<void*>(mapping), length);
+        }
+        mapping = nullptr;
+        length = 0;
+    }
+#endif
+} // namespace VulkanCube
@@ -0,0 +1,126 @@
+#include "../pch.h"
+#include "../include/vulkanktx2.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#include <vulkan/vulkan_format_traits.hpp>
+
+namespace VulkanCube {
+
+    // «KTX 20»\r\n\x1A\n, then the fixed header, the index and one entry per level
+    static constexpr unsigned char KTX2_IDENTIFIER[12] = {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+    static constexpr size_t KTX2_HEADER_SIZE = sizeof(KTX2_IDENTIFIER) + 9 * sizeof(uint32_t);
+    static constexpr size_t KTX2_INDEX_SIZE = 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+    static constexpr size_t KTX2_LEVEL_SIZE = 3 * sizeof(uint64_t);
+
+    template <typename T>
+    static T readField(const std::byte* data, size_t offset) {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    bool Ktx2File::isKtx2(std::span<const std::byte> data) {
+        return data.size() >= sizeof(KTX2_IDENTIFIER) &&
+            std::memcmp(data.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+    }
+
+    Ktx2File Ktx2File::open(const std::string& path) {
+        return parse(MappedFile::open(path), path);
+    }
+
+    Ktx2File Ktx2File::parse(MappedFile file, const std::string& path) {
+        const std::byte* data = file.data();
+        const size_t size = file.size();
+        if (!isKtx2(file.bytes()) || size < KTX2_HEADER_SIZE + KTX2_INDEX_SIZE) {
+            throw std::runtime_error("Not a KTX2 file: " + path);
+        }
+
+        // Header fields after the identifier, all little-endian uint32
+        size_t at = sizeof(KTX2_IDENTIFIER);
+        auto vkFormat = readField<uint32_t>(data, at + 0);
+        auto pixelWidth = readField<uint32_t>(data, at + 8);
+        auto pixelHeight = readField<uint32_t>(data, at + 12);
+        auto pixelDepth = readField<uint32_t>(data, at + 16);
+        auto layerCount = readField<uint32_t>(data, at + 20);
+        auto faceCount = readField<uint32_t>(data, at + 24);
+        auto levelCount = readField<uint32_t>(data, at + 28);
+        auto supercompression = readField<uint32_t>(data, at + 32);
+
+        if (vkFormat == VK_FORMAT_UNDEFINED || supercompression != 0) {
+            throw std::runtime_error("Supercompressed or Basis Universal KTX2 is not supported: " + path);
+        }
+        if (pixelWidth == 0 || pixelHeight == 0 || pixelDepth != 0 || layerCount > 1 || faceCount != 1) {
+            throw std::runtime_error("Only single 2D KTX2 textures are supported: " + path);
+        }
+
+        // A level count of 0 asks the loader to generate mips, which block formats cannot
+        // blit; upload the base level alone
+        uint32_t levels = std::max(levelCount, 1u);
+        size_t levelIndex = KTX2_HEADER_SIZE + KTX2_INDEX_SIZE;
+        if (levels > static_cast<uint32_t>(std::bit_width(std::max(pixelWidth, pixelHeight)))) {
+            throw std::runtime_error("More KTX2 mip levels than the texture size allows: " + path);
+        }
+        if ((size - levelIndex) / KTX2_LEVEL_SIZE < levels) {
+            throw std::runtime_error("Truncated KTX2 level index: " + path);
+        }
+
+        Ktx2File ktx;
+        ktx.format = static_cast<vk::Format>(vkFormat);
+        ktx.width = pixelWidth;
+        ktx.height = pixelHeight;
+
+        // Copy regions are built from each level's extent, so a level must hold every block
+        // of it or the upload would read past the data
+        const auto blockExtent = vk::blockExtent(ktx.format);
+        const uint64_t blockBytes = vk::blockSize(ktx.format);
+        if (blockBytes == 0) {
+            throw std::runtime_error("Unknown KTX2 vkFormat: " + path);
+        }
+
+        for (uint32_t level = 0; level < levels; level++) {
+            size_t entry = levelIndex + level * KTX2_LEVEL_SIZE;
+            auto byteOffset = readField<uint64_t>(data, entry);
+            auto byteLength = readField<uint64_t>(data, entry + 8);
+            if (byteLength == 0 || byteOffset > size || byteLength > size - byteOffset) {
+                throw std::runtime_error("KTX2 level data out of range: " + path);
+            }
+
+            uint64_t w = std::max(pixelWidth >> level, 1u);
+            uint64_t h = std::max(pixelHeight >> level, 1u);
+            uint64_t blocks = ((w + blockExtent[0] - 1) / blockExtent[0]) *
+                ((h + blockExtent[1] - 1) / blockExtent[1]);
+            if (byteLength < blocks * blockBytes) {
+                throw std::runtime_error("KTX2 level shorter than its extent: " + path);
+            }
+            ktx.levels.push_back({ static_cast<size_t>(byteOffset), static_cast<size_t>(byteLength) });
+        }
+        ktx.file = std::move(file);
+        return ktx;
+    }
+
+    bool isTextureFormatSupported(const Context& ctx, vk::Format format) {
+        // Block-compressed families need their device feature enabled as well
+        auto value = static_cast<VkFormat>(format);
+        if (value >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && value <= VK_FORMAT_BC7_SRGB_BLOCK &&
+            !ctx.deviceFeatures.textureCompressionBC) {
+            return false;
+        }
+        if (value >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && value <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK &&
+            !ctx.deviceFeatures.textureCompressionETC2) {
+            return false;
+        }
+        if (value >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && value <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK &&
+            !ctx.deviceFeatures.textureCompressionASTC_LDR) {
+            return false;
+        }
+
+        auto features = ctx.physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+        return static_cast<bool>(features & vk::FormatFeatureFlagBits::eSampledImage);
+    }
+} // namespace VulkanCube
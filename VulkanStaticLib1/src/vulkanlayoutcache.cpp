@@ -0,0 +1,181 @@
+#include "../pch.h"
+#include "../include/vulkancore.hpp"
+#include "../include/vulkanhash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    LayoutCache::LayoutCache(vk::Device device) : device(device) {
+    }
+
+    size_t LayoutCache::KeyHash::operator()(const SetLayoutKey& key) const {
+        Hasher h;
+        h.add(key.bindings.size());
+        for (const auto& b : key.bindings) {
+            h.add(b.binding).add(b.descriptorType).add(b.descriptorCount)
+                .add(static_cast<VkShaderStageFlags>(b.stageFlags)).add(b.pImmutableSamplers);
+        }
+        return static_cast<size_t>(h.value());
+    }
+
+    size_t LayoutCache::KeyHash::operator()(const PipelineLayoutKey& key) const {
+        Hasher h;
+        h.add(key.setLayouts.size());
+        for (const auto& layout : key.setLayouts) {
+            h.add(static_cast<VkDescriptorSetLayout>(layout));
+        }
+        h.add(key.pushConstantRanges.size());
+        for (const auto& range : key.pushConstantRanges) {
+            h.add(static_cast<VkShaderStageFlags>(range.stageFlags)).add(range.offset).add(range.size);
+        }
+        return static_cast<size_t>(h.value());
+    }
+
+    size_t LayoutCache::KeyHash::operator()(const RenderPassKey& key) const {
+        return static_cast<size_t>(Hasher().add(key.colorFormat).add(key.depthFormat).value());
+    }
+
+    vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayout(
+        std::span<const vk::DescriptorSetLayoutBinding> bindings) {
+        // Binding order does not change the layout, so normalize it before the lookup
+        SetLayoutKey key{ { bindings.begin(), bindings.end() } };
+        std::sort(key.bindings.begin(), key.bindings.end(), [](const auto& a, const auto& b) {
+            return a.binding < b.binding;
+        });
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = setLayouts.find(key);
+        if (it != setLayouts.end()) {
+            return *it->second;
+        }
+
+        // Runtime-sized arrays get a fixed capacity and the flags that let a set leave most
+        // of it unwritten and keep writing it while bound
+        std::vector<vk::DescriptorSetLayoutBinding> createBindings = key.bindings;
+        std::vector<vk::DescriptorBindingFlags> bindingFlags(createBindings.size());
+        vk::DescriptorSetLayoutCreateInfo createInfo({}, createBindings);
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo(bindingFlags);
+        for (size_t i = 0; i < createBindings.size(); i++) {
+            if (createBindings[i].descriptorCount != 0) {
+                continue;
+            }
+            if (i + 1 != createBindings.size()) {
+                throw std::runtime_error("A runtime-sized descriptor array must be the last binding of its set");
+            }
+            createBindings[i].descriptorCount = RUNTIME_ARRAY_CAPACITY;
+            bindingFlags[i] = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending |
+                vk::DescriptorBindingFlagBits::eVariableDescriptorCount;
+            createInfo.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+            createInfo.pNext = &flagsInfo;
+        }
+
+        auto result = device.createDescriptorSetLayoutUnique(createInfo);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create descriptor set layout!");
+        }
+
+        vk::DescriptorSetLayout layout = *result.value;
+        setLayouts.emplace(std::move(key), std::move(result.value));
+        return layout;
+    }
+
+    vk::PipelineLayout LayoutCache::getPipelineLayout(
+        std::span<const vk::DescriptorSetLayout> setLayoutHandles,
+        std::span<const vk::PushConstantRange> pushConstantRanges) {
+        PipelineLayoutKey key{
+            { setLayoutHandles.begin(), setLayoutHandles.end() },
+            { pushConstantRanges.begin(), pushConstantRanges.end() } };
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pipelineLayouts.find(key);
+        if (it != pipelineLayouts.end()) {
+            return *it->second;
+        }
+
+        vk::PipelineLayoutCreateInfo createInfo({}, key.setLayouts, key.pushConstantRanges);
+        auto result = device.createPipelineLayoutUnique(createInfo);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+
+        vk::PipelineLayout layout = *result.value;
+        pipelineLayouts.emplace(std::move(key), std::move(result.value));
+        return layout;
+    }
+
+    vk::RenderPass LayoutCache::getRenderPass(vk::Format colorFormat, vk::Format depthFormat) {
+        RenderPassKey key{ colorFormat, depthFormat };
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = renderPasses.find(key);
+        if (it != renderPasses.end()) {
+            return *it->second;
+        }
+
+        std::array<vk::AttachmentDescription, 2> attachments = { {
+                // Color attachment
+                {
+                    {}, colorFormat, vk::SampleCountFlagBits::e1,
+                    vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+                    vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR
+                },
+            // Depth attachment
+            {
+                {}, depthFormat, vk::SampleCountFlagBits::e1,
+                vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare,
+                vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal
+            }
+        } };
+
+        vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+        vk::AttachmentReference depthRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+        vk::SubpassDescription subpass(
+            {}, vk::PipelineBindPoint::eGraphics,
+            0, nullptr, 1, &colorRef, nullptr, &depthRef
+        );
+
+        vk::SubpassDependency dependency(
+            VK_SUBPASS_EXTERNAL, 0,
+            vk::PipelineStageFlagBits::eColorAttachmentOutput |
+            vk::PipelineStageFlagBits::eEarlyFragmentTests,
+            vk::PipelineStageFlagBits::eColorAttachmentOutput |
+            vk::PipelineStageFlagBits::eEarlyFragmentTests,
+            {},
+            vk::AccessFlagBits::eColorAttachmentWrite |
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite
+        );
+
+        vk::RenderPassCreateInfo createInfo({}, attachments, subpass, dependency);
+        auto result = device.createRenderPassUnique(createInfo);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create render pass!");
+        }
+
+        vk::RenderPass renderPass = *result.value;
+        renderPasses.emplace(key, std::move(result.value));
+        return renderPass;
+    }
+
+    size_t LayoutCache::descriptorSetLayoutCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return setLayouts.size();
+    }
+
+    size_t LayoutCache::pipelineLayoutCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pipelineLayouts.size();
+    }
+
+    size_t LayoutCache::renderPassCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return renderPasses.size();
+    }
+} // namespace VulkanCube
@@ -1,126 +1,277 @@
 #include "../pch.h"
 
 #include "../include/vulkanpipeline.hpp"
-
-#include <fstream>
+#include "../include/vulkanhash.hpp"
+#include "../include/vulkanpipelinemanifest.hpp"
 
 namespace VulkanCube {
 
+    PipelineDesc PipelineDesc::makeDefault(const Context& ctx,
+        ShaderCode vertCode, ShaderCode fragCode) {
+        PipelineDesc desc;
+        desc.vertCode = vertCode;
+        desc.fragCode = fragCode;
+
+        desc.colorFormat = ctx.swapchainFormat;
+        desc.depthFormat = findDepthFormat(ctx.physicalDevice);
+        return desc;
+    }
+
+    uint64_t PipelineDesc::hash() const {
+        Hasher h;
+        h.add(vertCode.words.size()).bytes(vertCode.words.data(), vertCode.words.size_bytes());
+        h.add(fragCode.words.size()).bytes(fragCode.words.data(), fragCode.words.size_bytes());
+
+        h.add(vertexBindings.size());
+        for (const auto& b : vertexBindings) {
+            h.add(b.binding).add(b.stride).add(b.inputRate);
+        }
+        h.add(vertexAttributes.size());
+        for (const auto& a : vertexAttributes) {
+            h.add(a.location).add(a.binding).add(a.format).add(a.offset);
+        }
+        h.add(topology);
+
+        h.add(polygonMode).add(static_cast<VkCullModeFlags>(cullMode)).add(frontFace);
+        h.add(depthTest).add(depthWrite).add(depthCompare);
+
+        h.add(blendEnable)
+            .add(srcColorBlend).add(dstColorBlend).add(colorBlendOp)
+            .add(srcAlphaBlend).add(dstAlphaBlend).add(alphaBlendOp)
+            .add(static_cast<VkColorComponentFlags>(colorWriteMask));
+
+        h.add(colorFormat).add(depthFormat);
+
+        h.add(pushConstantRanges.size());
+        for (const auto& range : pushConstantRanges) {
+            h.add(static_cast<VkShaderStageFlags>(range.stageFlags)).add(range.offset).add(range.size);
+        }
+
+        h.add(specEntries.size());
+        for (const auto& entry : specEntries) {
+            h.add(entry.constantID).add(entry.offset).add(entry.size);
+        }
+        h.add(specData.size()).bytes(specData.data(), specData.size());
+        return h.value();
+    }
+
     GraphicsPipeline GraphicsPipeline::create(
         const Context& ctx,
-        const std::vector<char>& vertCode,
-        const std::vector<char>& fragCode
+        ShaderCode vertCode,
+        ShaderCode fragCode,
+        std::span<const vk::PushConstantRange> pushConstantRanges
     ) {
-        GraphicsPipeline gp;
-
-        // Render pass creation
-        std::array<vk::AttachmentDescription, 2> attachments = { {
-                // Color attachment
-                {
-                    {}, ctx.swapchainFormat, vk::SampleCountFlagBits::e1,
-                    vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
-                    vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-                    vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR
-                },
-            // Depth attachment
-            {
-                {}, findDepthFormat(ctx.physicalDevice), vk::SampleCountFlagBits::e1,
-                vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare,
-                vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-                vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal
-            }
-        } };
-
-        vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
-        vk::AttachmentReference depthRef(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+        PipelineDesc desc = PipelineDesc::makeDefault(ctx, vertCode, fragCode);
+        desc.pushConstantRanges.assign(pushConstantRanges.begin(), pushConstantRanges.end());
+        return create(ctx, desc);
+    }
 
-        vk::SubpassDescription subpass(
-            {}, vk::PipelineBindPoint::eGraphics,
-            0, nullptr, 1, &colorRef, nullptr, &depthRef
-        );
+    GraphicsPipeline GraphicsPipeline::create(const Context& ctx, const PipelineDesc& desc) {
+        auto build = PipelineBuild::prepare(ctx, desc);
+        auto result = ctx.device->createGraphicsPipelineUnique(*ctx.pipelineCache.cache, build->info);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create graphics pipeline!");
+        }
+        build->pipeline.pipeline = std::move(result.value);
+        return std::move(build->pipeline);
+    }
 
-        vk::SubpassDependency dependency(
-            VK_SUBPASS_EXTERNAL, 0,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput |
-            vk::PipelineStageFlagBits::eEarlyFragmentTests,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput |
-            vk::PipelineStageFlagBits::eEarlyFragmentTests,
-            {},
-            vk::AccessFlagBits::eColorAttachmentWrite |
-            vk::AccessFlagBits::eDepthStencilAttachmentWrite
-        );
+    std::unique_ptr<PipelineBuild> PipelineBuild::prepare(const Context& ctx, const PipelineDesc& desc) {
+        auto build = std::make_unique<PipelineBuild>();
+        GraphicsPipeline& gp = build->pipeline;
 
-        vk::RenderPassCreateInfo renderPassInfo({}, attachments, subpass, dependency);
-        gp.renderPass = ctx.device->createRenderPassUnique(renderPassInfo).value;
+        // Shader interface, read from the SPIR-V itself
+        gp.reflection = ShaderReflection::reflect(desc.vertCode.words);
+        gp.reflection.merge(ShaderReflection::reflect(desc.fragCode.words));
 
-        // Descriptor set layout
-        std::array<vk::DescriptorSetLayoutBinding, 2> bindings = { {
-            {0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex},
-            {1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment}
-        } };
+        // Render pass, shared by every pipeline with the same attachment formats
+        gp.renderPass = ctx.layoutCache->getRenderPass(desc.colorFormat, desc.depthFormat);
 
-        gp.descriptorSetLayout = ctx.device->createDescriptorSetLayoutUnique(
-            { {}, static_cast<uint32_t>(bindings.size()), bindings.data() }).value;
+        // Descriptor set layouts, one per set index up to the highest the shaders use
+        for (uint32_t set = 0; set < gp.reflection.setCount(); set++) {
+            gp.descriptorSetLayouts.push_back(
+                ctx.layoutCache->getDescriptorSetLayout(gp.reflection.setLayoutBindings(set)));
+        }
 
         // Pipeline layout
-        vk::PipelineLayoutCreateInfo layoutInfo({}, 1, &*gp.descriptorSetLayout);
-        gp.layout = ctx.device->createPipelineLayoutUnique(layoutInfo).value;
+        gp.pushConstantRanges = desc.pushConstantRanges.empty()
+            ? gp.reflection.pushConstantRanges : desc.pushConstantRanges;
+        gp.layout = ctx.layoutCache->getPipelineLayout(gp.descriptorSetLayouts, gp.pushConstantRanges);
 
         // Shaders
-        auto vertShader = createShaderModule(*ctx.device, vertCode);
-        auto fragShader = createShaderModule(*ctx.device, fragCode);
-
-        // Pipeline states
-        vk::PipelineShaderStageCreateInfo vertStage(
-            {}, vk::ShaderStageFlagBits::eVertex, *vertShader, "main");
-        vk::PipelineShaderStageCreateInfo fragStage(
-            {}, vk::ShaderStageFlagBits::eFragment, *fragShader, "main");
-        std::array stages = { vertStage, fragStage };
-
-        auto bindingDesc = Vertex::getBindingDescription();
-        auto attributeDescs = Vertex::getAttributeDescriptions();
-
-        vk::PipelineVertexInputStateCreateInfo vertexInput(
-            {}, 1, &bindingDesc,
-            static_cast<uint32_t>(attributeDescs.size()), attributeDescs.data());
-
-        vk::PipelineInputAssemblyStateCreateInfo inputAssembly(
-            {}, vk::PrimitiveTopology::eTriangleList);
-
-        vk::Viewport viewport(0.0f, 0.0f,
-            static_cast<float>(ctx.swapchainExtent.width),
-            static_cast<float>(ctx.swapchainExtent.height),
-            0.0f, 1.0f);
-        vk::Rect2D scissor({ 0, 0 }, ctx.swapchainExtent);
-        vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
-
-        vk::PipelineRasterizationStateCreateInfo rasterizer(
-            {}, false, false, vk::PolygonMode::eFill,
-            vk::CullModeFlagBits::eBack, vk::FrontFace::eCounterClockwise);
-
-        vk::PipelineMultisampleStateCreateInfo multisampling;
-        vk::PipelineDepthStencilStateCreateInfo depthStencil(
-            {}, true, true, vk::CompareOp::eLess);
-
-        vk::PipelineColorBlendAttachmentState colorBlendAttachment;
-        colorBlendAttachment.colorWriteMask =
-            vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-            vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
-
-        vk::PipelineColorBlendStateCreateInfo colorBlending(
-            {}, false, vk::LogicOp::eCopy, 1, &colorBlendAttachment);
-
-        // Pipeline creation
-        vk::GraphicsPipelineCreateInfo pipelineInfo(
-            {}, stages, &vertexInput, &inputAssembly,
-            nullptr, &viewportState, &rasterizer, &multisampling,
-            &depthStencil, &colorBlending, nullptr,
-            *gp.layout, *gp.renderPass
+        build->vertShader = createShaderModule(*ctx.device, desc.vertCode.words);
+        build->fragShader = createShaderModule(*ctx.device, desc.fragCode.words);
+
+        // Pipeline states; everything below is referenced by build->info and must live in build
+        build->specEntries = desc.specEntries;
+        build->specData = desc.specData;
+        build->specialization = vk::SpecializationInfo(
+            static_cast<uint32_t>(build->specEntries.size()), build->specEntries.data(),
+            build->specData.size(), build->specData.data());
+        const vk::SpecializationInfo* specialization =
+            build->specEntries.empty() ? nullptr : &build->specialization;
+
+        build->stages = { {
+            { {}, vk::ShaderStageFlagBits::eVertex, *build->vertShader, "main", specialization },
+            { {}, vk::ShaderStageFlagBits::eFragment, *build->fragShader, "main", specialization }
+        } };
+
+        if (desc.vertexAttributes.empty()) {
+            gp.reflection.vertexInput(build->vertexBindings, build->vertexAttributes);
+        }
+        else {
+            build->vertexBindings = desc.vertexBindings;
+            build->vertexAttributes = desc.vertexAttributes;
+        }
+        build->vertexInput = vk::PipelineVertexInputStateCreateInfo(
+            {}, build->vertexBindings, build->vertexAttributes);
+
+        build->inputAssembly = vk::PipelineInputAssemblyStateCreateInfo({}, desc.topology);
+
+        // Viewport and scissor are set while recording, so a resize never invalidates the pipeline
+        build->viewportState = vk::PipelineViewportStateCreateInfo({}, 1, nullptr, 1, nullptr);
+        build->dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+        build->dynamicState = vk::PipelineDynamicStateCreateInfo({}, build->dynamicStates);
+
+        build->rasterizer = vk::PipelineRasterizationStateCreateInfo(
+            {}, false, false, desc.polygonMode,
+            desc.cullMode, desc.frontFace);
+        build->rasterizer.lineWidth = 1.0f;
+
+        build->depthStencil = vk::PipelineDepthStencilStateCreateInfo(
+            {}, desc.depthTest, desc.depthWrite, desc.depthCompare);
+
+        build->colorBlendAttachment = vk::PipelineColorBlendAttachmentState(
+            desc.blendEnable,
+            desc.srcColorBlend, desc.dstColorBlend, desc.colorBlendOp,
+            desc.srcAlphaBlend, desc.dstAlphaBlend, desc.alphaBlendOp,
+            desc.colorWriteMask);
+
+        build->colorBlending = vk::PipelineColorBlendStateCreateInfo(
+            {}, false, vk::LogicOp::eCopy, 1, &build->colorBlendAttachment);
+
+        build->info = vk::GraphicsPipelineCreateInfo(
+            {}, build->stages, &build->vertexInput, &build->inputAssembly,
+            nullptr, &build->viewportState, &build->rasterizer, &build->multisampling,
+            &build->depthStencil, &build->colorBlending, &build->dynamicState,
+            gp.layout, gp.renderPass
         );
 
-        gp.pipeline = ctx.device->createGraphicsPipelineUnique(nullptr, pipelineInfo).value;
+        return build;
+    }
+
+    PipelineStateCache::Handle PipelineStateCache::getOrCreate(const Context& ctx, const PipelineDesc& desc) {
+        std::promise<Handle> promise;
+        bool inserted = false;
+        auto entry = lookupOrInsert(desc, promise.get_future().share(), inserted);
+        if (!inserted) {
+            return entry.get();
+        }
 
-        return gp;
+        // Compile outside the lock; other threads asking for this desc block on the future
+        try {
+            auto handle = std::make_shared<const GraphicsPipeline>(GraphicsPipeline::create(ctx, desc));
+            promise.set_value(handle);
+            recordCompiled(desc);
+            return handle;
+        }
+        catch (...) {
+            erase(desc);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    std::shared_future<PipelineStateCache::Handle> PipelineStateCache::lookupOrInsert(
+        const PipelineDesc& desc, std::shared_future<Handle> pending, bool& inserted) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, isNew] = entries.try_emplace(desc, std::move(pending));
+        inserted = isNew;
+        if (isNew) {
+            ++missCount;
+        }
+        else {
+            ++hitCount;
+        }
+        return it->second;
+    }
+
+    void PipelineStateCache::erase(const PipelineDesc& desc) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(desc);
+    }
+
+    void PipelineStateCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+
+    void PipelineStateCache::recordCompiled(const PipelineDesc& desc) {
+        if (PipelineManifest* log = manifest.load()) {
+            log->record(desc);
+        }
+    }
+
+    void PipelineStateCache::setManifest(PipelineManifest* manifest) {
+        this->manifest = manifest;
+    }
+
+    size_t PipelineStateCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    ShaderVariantCache::ShaderVariantCache(PipelineStateCache& states, PipelineDesc base,
+        std::vector<uint32_t> featureIds)
+        : states(states), base(std::move(base)), featureIds(std::move(featureIds)) {
+        if (this->featureIds.size() > sizeof(Mask) * 8) {
+            throw std::runtime_error("Too many shader features for the variant mask!");
+        }
+
+        // Catch a renamed or retyped constant here rather than as a silently ignored toggle
+        ShaderReflection reflection = ShaderReflection::reflect(this->base.vertCode.words);
+        reflection.merge(ShaderReflection::reflect(this->base.fragCode.words));
+        for (uint32_t id : this->featureIds) {
+            auto it = std::find_if(reflection.specConstants.begin(), reflection.specConstants.end(),
+                [id](const ShaderReflection::SpecConstant& c) { return c.id == id; });
+            if (it == reflection.specConstants.end() || it->type != ShaderReflection::SpecConstant::Type::Bool) {
+                throw std::runtime_error("No bool specialization constant with constant_id " + std::to_string(id));
+            }
+        }
+    }
+
+    PipelineDesc ShaderVariantCache::describe(Mask features) const {
+        PipelineDesc desc = base;
+        for (size_t bit = 0; bit < featureIds.size(); bit++) {
+            desc.specialize(featureIds[bit], (features & (Mask(1) << bit)) != 0);
+        }
+        return desc;
+    }
+
+    ShaderVariantCache::Handle ShaderVariantCache::get(const Context& ctx, Mask features) {
+        // Bits without a feature behind them would only duplicate an existing variant
+        if (featureIds.size() < sizeof(Mask) * 8) {
+            features &= (Mask(1) << featureIds.size()) - 1;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = variants.find(features);
+            if (it != variants.end()) {
+                return it->second;
+            }
+        }
+
+        // PipelineStateCache makes concurrent first requests for the same mask compile once
+        Handle handle = states.getOrCreate(ctx, describe(features));
+        std::lock_guard<std::mutex> lock(mutex);
+        variants.emplace(features, handle);
+        return handle;
+    }
+
+    size_t ShaderVariantCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return variants.size();
     }
 
     vk::VertexInputBindingDescription VulkanCube::Vertex::getBindingDescription() {
@@ -135,25 +286,31 @@ namespace VulkanCube {
     }
 
     std::vector<char> readFile(const std::string& filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        MappedFile file = MappedFile::open(filename);
+        const char* data = reinterpret_cast<const char*>(file.data());
+        return std::vector<char>(data, data + file.size());
+    }
 
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open file: " + filename);
+    MappedFile mapSpirvFile(const std::string& filename) {
+        MappedFile file = MappedFile::open(filename);
+        if (file.empty() || file.size() % sizeof(uint32_t) != 0 || file.words()[0] != 0x07230203) {
+            throw std::runtime_error("Not a SPIR-V module: " + filename);
         }
+        return file;
+    }
 
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-
-        return buffer;
+    std::vector<uint32_t> readSpirvFile(const std::string& filename) {
+        MappedFile file = mapSpirvFile(filename);
+        auto words = file.words();
+        return std::vector<uint32_t>(words.begin(), words.end());
     }
 
-    vk::UniqueShaderModule createShaderModule(vk::Device device, const std::vector<char>& code) {
-        vk::ShaderModuleCreateInfo createInfo(
-            {}, code.size(), reinterpret_cast<const uint32_t*>(code.data()));
-        return device.createShaderModuleUnique(createInfo).value;
+    vk::UniqueShaderModule createShaderModule(vk::Device device, std::span<const uint32_t> code) {
+        vk::ShaderModuleCreateInfo createInfo({}, code.size_bytes(), code.data());
+        auto result = device.createShaderModuleUnique(createInfo);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create shader module!");
+        }
+        return std::move(result.value);
     }
 } // namespace VulkanCube
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "../pch.h"
+#include "../include/vulkancore.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace VulkanCube {
+
+    // Layout of VkPipelineCacheHeaderVersionOne, read field by field to stay independent of padding
+    static constexpr size_t PIPELINE_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+    static std::vector<char> readCacheFile(const std::string& path) {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return {};
+        }
+
+        size_t fileSize = (size_t)file.tellg();
+        std::vector<char> buffer(fileSize);
+
+        file.seekg(0);
+        file.read(buffer.data(), fileSize);
+        return file ? buffer : std::vector<char>{};
+    }
+
+    bool PipelineCache::isCompatible(const std::vector<char>& data,
+        const vk::PhysicalDeviceProperties& properties) {
+        if (data.size() < PIPELINE_CACHE_HEADER_SIZE) {
+            return false;
+        }
+
+        uint32_t headerSize, headerVersion, vendorID, deviceID;
+        std::memcpy(&headerSize, data.data() + 0, sizeof(uint32_t));
+        std::memcpy(&headerVersion, data.data() + 4, sizeof(uint32_t));
+        std::memcpy(&vendorID, data.data() + 8, sizeof(uint32_t));
+        std::memcpy(&deviceID, data.data() + 12, sizeof(uint32_t));
+
+        return headerSize >= PIPELINE_CACHE_HEADER_SIZE &&
+            headerSize <= data.size() &&
+            headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            vendorID == properties.vendorID &&
+            deviceID == properties.deviceID &&
+            std::memcmp(data.data() + 16, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+    }
+
+    PipelineCache PipelineCache::create(vk::Device device,
+        const vk::PhysicalDeviceProperties& properties, const std::string& path) {
+        PipelineCache pc;
+        pc.path = path;
+        pc.lastSave = std::chrono::steady_clock::now();
+
+        // A stale blob from another driver or GPU is dropped rather than handed to the driver
+        std::vector<char> data = readCacheFile(path);
+        if (!isCompatible(data, properties)) {
+            data.clear();
+        }
+
+        vk::PipelineCacheCreateInfo createInfo({}, data.size(), data.data());
+        auto result = device.createPipelineCacheUnique(createInfo);
+        if (result.result != vk::Result::eSuccess && !data.empty()) {
+            // Header matched but the driver still rejected the payload; start cold
+            createInfo = vk::PipelineCacheCreateInfo();
+            data.clear();
+            result = device.createPipelineCacheUnique(createInfo);
+        }
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+
+        pc.cache = std::move(result.value);
+        pc.loadedFromDisk = !data.empty();
+        return pc;
+    }
+
+    bool PipelineCache::save(vk::Device device) {
+        if (!cache || path.empty()) {
+            return false;
+        }
+
+        auto data = device.getPipelineCacheData(*cache);
+        if (data.result != vk::Result::eSuccess || data.value.empty()) {
+            return false;
+        }
+
+        // Write beside the target and rename over it so a crash never leaves a torn file
+        const std::string tempPath = path + ".tmp";
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(data.value.data()), data.value.size());
+
+        // close() flushes; a failure there must not replace the good cache either
+        file.close();
+        std::error_code ec;
+        if (!file) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+
+        lastSave = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    bool PipelineCache::saveIfDue(vk::Device device, std::chrono::seconds interval) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSave < interval) {
+            return false;
+        }
+        // Failed writes wait for the next interval instead of retrying every frame
+        lastSave = now;
+        return save(device);
+    }
+} // namespace VulkanCube
@@ -0,0 +1,147 @@
+#include "../pch.h"
+#include "../include/vulkanpipelinecompiler.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    PipelineCompiler::PipelineCompiler(const Context& ctx, PipelineStateCache& cache, uint32_t threadCount)
+        : ctx(ctx), cache(cache), workers(threadCount) {
+    }
+
+    PipelineCompiler::~PipelineCompiler() {
+        workers.waitIdle();
+    }
+
+    PipelineCompiler::Future PipelineCompiler::compileAsync(const PipelineDesc& desc) {
+        auto request = std::make_unique<Request>();
+        request->desc = desc;
+        Future future = request->promise.get_future().share();
+
+        // Already compiled or queued by someone else
+        bool inserted = false;
+        Future entry = cache.lookupOrInsert(desc, future, inserted);
+        if (!inserted) {
+            return entry;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(request));
+        }
+
+        // Each submit schedules one drain; a drain that runs late may find its requests
+        // already taken by an earlier batch and simply returns
+        workers.submit([this] { compileBatch(); });
+        return future;
+    }
+
+    PipelineCompiler::Future PipelineCompiler::buildAsync(const PipelineDesc& desc,
+        std::function<GraphicsPipeline()> build) {
+        auto request = std::make_shared<Request>();
+        request->desc = desc;
+        Future future = request->promise.get_future().share();
+
+        bool inserted = false;
+        Future entry = cache.lookupOrInsert(desc, future, inserted);
+        if (!inserted) {
+            return entry;
+        }
+
+        workers.submit([this, request, build = std::move(build)] {
+            Handle handle;
+            try {
+                handle = std::make_shared<const GraphicsPipeline>(build());
+            }
+            catch (...) {
+                fail(*request, std::current_exception());
+                return;
+            }
+            request->promise.set_value(std::move(handle));
+            cache.recordCompiled(request->desc);
+        });
+        return future;
+    }
+
+    void PipelineCompiler::waitIdle() {
+        workers.waitIdle();
+    }
+
+    PipelineCompiler::Handle PipelineCompiler::readyOr(const Future& future, Handle fallback) {
+        if (!future.valid() ||
+            future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return fallback;
+        }
+
+        try {
+            return future.get();
+        }
+        catch (...) {
+            return fallback;
+        }
+    }
+
+    void PipelineCompiler::fail(Request& request, std::exception_ptr error) {
+        cache.erase(request.desc);
+        request.promise.set_exception(error);
+    }
+
+    void PipelineCompiler::compileBatch() {
+        std::vector<std::unique_ptr<Request>> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!pending.empty() && batch.size() < MAX_BATCH_SIZE) {
+                batch.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+        }
+        if (batch.empty()) {
+            return;
+        }
+
+        // Render passes, layouts and shader modules for every request in the batch
+        std::vector<Request*> owners;
+        std::vector<std::unique_ptr<PipelineBuild>> builds;
+        std::vector<vk::GraphicsPipelineCreateInfo> createInfos;
+        for (auto& request : batch) {
+            try {
+                builds.push_back(PipelineBuild::prepare(ctx, request->desc));
+                createInfos.push_back(builds.back()->info);
+                owners.push_back(request.get());
+            }
+            catch (...) {
+                fail(*request, std::current_exception());
+            }
+        }
+        if (createInfos.empty()) {
+            return;
+        }
+
+        auto finish = [this](Request& request, PipelineBuild& build, vk::UniquePipeline pipeline) {
+            if (!pipeline) {
+                fail(request, std::make_exception_ptr(std::runtime_error("Failed to create graphics pipeline!")));
+                return;
+            }
+            build.pipeline.pipeline = std::move(pipeline);
+            request.promise.set_value(std::make_shared<const GraphicsPipeline>(std::move(build.pipeline)));
+            cache.recordCompiled(request.desc);
+        };
+
+        // One driver call for the whole batch
+        auto result = ctx.device->createGraphicsPipelinesUnique(*ctx.pipelineCache.cache, createInfos);
+        if (result.result == vk::Result::eSuccess) {
+            for (size_t i = 0; i < builds.size(); i++) {
+                finish(*owners[i], *builds[i], std::move(result.value[i]));
+            }
+            return;
+        }
+
+        // A single bad create info fails the whole call; retry one by one so the rest survive
+        for (size_t i = 0; i < builds.size(); i++) {
+            auto single = ctx.device->createGraphicsPipelineUnique(*ctx.pipelineCache.cache, builds[i]->info);
+            finish(*owners[i], *builds[i],
+                single.result == vk::Result::eSuccess ? std::move(single.value) : vk::UniquePipeline());
+        }
+    }
+} // namespace VulkanCube
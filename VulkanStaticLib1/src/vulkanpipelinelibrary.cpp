@@ -0,0 +1,182 @@
+#include "../pch.h"
+#include "../include/vulkanpipelinelibrary.hpp"
+#include "../include/vulkanhash.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    PipelineLibraryCache::PipelineLibraryCache(const Context& ctx, PipelineCompiler& compiler)
+        : ctx(ctx), compiler(compiler) {
+        if (!ctx.graphicsPipelineLibrary) {
+            throw std::runtime_error("VK_EXT_graphics_pipeline_library is not enabled on this device!");
+        }
+    }
+
+    PipelineLibraryCache::~PipelineLibraryCache() {
+        // Queued optimized links still call back into this cache
+        compiler.waitIdle();
+    }
+
+    PipelineLibraryCache::Linked PipelineLibraryCache::get(const PipelineDesc& desc) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = fastLinked.find(desc);
+            if (it != fastLinked.end()) {
+                return it->second;
+            }
+        }
+
+        // Queue the optimized link first; if the state cache already holds desc, use that
+        Linked linked;
+        linked.optimized = compiler.buildAsync(desc, [this, desc] { return link(desc, true); });
+        if (linked.optimized.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            linked.fast = PipelineCompiler::readyOr(linked.optimized);
+            if (linked.fast) {
+                return linked;
+            }
+        }
+
+        linked.fast = std::make_shared<const GraphicsPipeline>(link(desc, false));
+        std::lock_guard<std::mutex> lock(mutex);
+        return fastLinked.try_emplace(desc, linked).first->second;
+    }
+
+    void PipelineLibraryCache::releaseFastLinked() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::erase_if(fastLinked, [](const auto& entry) {
+            const Linked& linked = entry.second;
+            return linked.optimized.valid() &&
+                linked.optimized.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+    }
+
+    size_t PipelineLibraryCache::partCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return parts.size();
+    }
+
+    GraphicsPipeline PipelineLibraryCache::link(const PipelineDesc& desc, bool optimize) {
+        // Render pass, layouts and the resolved state every part is built from
+        auto build = PipelineBuild::prepare(ctx, desc);
+
+        std::array<vk::Pipeline, 4> libraries = {
+            getPart(Part::VertexInput, desc, *build),
+            getPart(Part::PreRasterization, desc, *build),
+            getPart(Part::FragmentShader, desc, *build),
+            getPart(Part::FragmentOutput, desc, *build),
+        };
+
+        vk::PipelineLibraryCreateInfoKHR libraryInfo(libraries);
+        vk::GraphicsPipelineCreateInfo info;
+        info.pNext = &libraryInfo;
+        info.layout = build->pipeline.layout;
+        if (optimize) {
+            info.flags = vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+        }
+
+        auto result = ctx.device->createGraphicsPipelineUnique(*ctx.pipelineCache.cache, info);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to link graphics pipeline library!");
+        }
+        build->pipeline.pipeline = std::move(result.value);
+        return std::move(build->pipeline);
+    }
+
+    size_t PipelineLibraryCache::PartKeyHash::operator()(const PartKey& key) const {
+        Hasher h;
+        h.add(key.part).add(key.state.hash()).add(static_cast<VkPipelineLayout>(key.layout));
+        h.add(key.code.size()).bytes(key.code.data(), key.code.size() * sizeof(uint32_t));
+        return static_cast<size_t>(h.value());
+    }
+
+    vk::Pipeline PipelineLibraryCache::getPart(Part part, const PipelineDesc& desc, const PipelineBuild& build) {
+        // Key only the state this part depends on; render pass compatibility is covered by
+        // the formats, shader interfaces by the layout handle the LayoutCache deduplicated
+        PartKey key{ part };
+        PipelineDesc& state = key.state;
+        auto specialize = [&] {
+            state.specEntries = desc.specEntries;
+            state.specData = desc.specData;
+        };
+
+        vk::GraphicsPipelineLibraryFlagsEXT flags;
+        const vk::PipelineShaderStageCreateInfo* stage = nullptr;
+        switch (part) {
+        case Part::VertexInput:
+            flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface;
+            state.vertexBindings = build.vertexBindings;
+            state.vertexAttributes = build.vertexAttributes;
+            state.topology = desc.topology;
+            break;
+
+        case Part::PreRasterization:
+            flags = vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders;
+            stage = &build.stages[0];
+            key.code.assign(desc.vertCode.words.begin(), desc.vertCode.words.end());
+            key.layout = build.pipeline.layout;
+            state.polygonMode = desc.polygonMode;
+            state.cullMode = desc.cullMode;
+            state.frontFace = desc.frontFace;
+            state.colorFormat = desc.colorFormat;
+            state.depthFormat = desc.depthFormat;
+            specialize();
+            break;
+
+        case Part::FragmentShader:
+            flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader;
+            stage = &build.stages[1];
+            key.code.assign(desc.fragCode.words.begin(), desc.fragCode.words.end());
+            key.layout = build.pipeline.layout;
+            state.depthTest = desc.depthTest;
+            state.depthWrite = desc.depthWrite;
+            state.depthCompare = desc.depthCompare;
+            state.colorFormat = desc.colorFormat;
+            state.depthFormat = desc.depthFormat;
+            specialize();
+            break;
+
+        case Part::FragmentOutput:
+            flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface;
+            state.blendEnable = desc.blendEnable;
+            state.srcColorBlend = desc.srcColorBlend;
+            state.dstColorBlend = desc.dstColorBlend;
+            state.colorBlendOp = desc.colorBlendOp;
+            state.srcAlphaBlend = desc.srcAlphaBlend;
+            state.dstAlphaBlend = desc.dstAlphaBlend;
+            state.alphaBlendOp = desc.alphaBlendOp;
+            state.colorWriteMask = desc.colorWriteMask;
+            state.colorFormat = desc.colorFormat;
+            state.depthFormat = desc.depthFormat;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = parts.find(key);
+            if (it != parts.end()) {
+                return *it->second;
+            }
+        }
+
+        // State outside this part's subset is ignored by the driver, so the full create info
+        // can be reused with just the stage narrowed
+        vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo(flags);
+        vk::GraphicsPipelineCreateInfo info = build.info;
+        info.pNext = &libraryInfo;
+        info.flags = vk::PipelineCreateFlagBits::eLibraryKHR |
+            vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+        info.stageCount = stage ? 1 : 0;
+        info.pStages = stage;
+
+        auto result = ctx.device->createGraphicsPipelineUnique(*ctx.pipelineCache.cache, info);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create graphics pipeline library part!");
+        }
+
+        // Another thread may have built the same part meanwhile; keep the first
+        std::lock_guard<std::mutex> lock(mutex);
+        return *parts.try_emplace(std::move(key), std::move(result.value)).first->second;
+    }
+} // namespace VulkanCube
@@ -0,0 +1,334 @@
+#include "../pch.h"
+#include "../include/vulkanpipelinemanifest.hpp"
+#include "../include/vulkanfiles.hpp"
+#include "../include/vulkanhash.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace VulkanCube {
+
+    // File layout: magic, version, entry count, checksum of everything after the header,
+    // then per entry its desc hash, byte length and serialized desc. Values are stored in
+    // host byte order; the manifest is a per-machine cache like the pipeline cache.
+    static constexpr uint32_t MANIFEST_MAGIC = 0x4D504356;     // "VCPM"
+    static constexpr uint32_t MANIFEST_VERSION = 1;
+
+    namespace {
+        struct Writer {
+            std::vector<uint8_t>& out;
+
+            template <typename T>
+            void put(T value) {
+                size_t offset = out.size();
+                out.resize(offset + sizeof(T));
+                std::memcpy(out.data() + offset, &value, sizeof(T));
+            }
+
+            void u32(uint32_t value) { put(value); }
+            void u64(uint64_t value) { put(value); }
+        };
+
+        // Every read is bounds-checked; running off the end clears `ok` and yields zeros
+        struct Reader {
+            const uint8_t* data;
+            size_t size;
+            size_t offset = 0;
+            bool ok = true;
+
+            template <typename T>
+            T get() {
+                T value{};
+                if (!ok || size - offset < sizeof(T)) {
+                    ok = false;
+                    return value;
+                }
+                std::memcpy(&value, data + offset, sizeof(T));
+                offset += sizeof(T);
+                return value;
+            }
+
+            uint32_t u32() { return get<uint32_t>(); }
+            uint64_t u64() { return get<uint64_t>(); }
+
+            // Guards vector sizes read from the file before they are allocated
+            uint32_t count(size_t elementSize) {
+                uint32_t n = u32();
+                if (ok && n > (size - offset) / elementSize) {
+                    ok = false;
+                }
+                return ok ? n : 0;
+            }
+        };
+    }
+
+    static std::vector<uint8_t> serialize(const PipelineDesc& desc) {
+        std::vector<uint8_t> bytes;
+        Writer w{ bytes };
+
+        w.u64(ShaderRegistry::key(desc.vertCode));
+        w.u64(ShaderRegistry::key(desc.fragCode));
+
+        w.u32(static_cast<uint32_t>(desc.vertexBindings.size()));
+        for (const auto& b : desc.vertexBindings) {
+            w.u32(b.binding);
+            w.u32(b.stride);
+            w.u32(static_cast<uint32_t>(b.inputRate));
+        }
+        w.u32(static_cast<uint32_t>(desc.vertexAttributes.size()));
+        for (const auto& a : desc.vertexAttributes) {
+            w.u32(a.location);
+            w.u32(a.binding);
+            w.u32(static_cast<uint32_t>(a.format));
+            w.u32(a.offset);
+        }
+        w.u32(static_cast<uint32_t>(desc.topology));
+
+        w.u32(static_cast<uint32_t>(desc.polygonMode));
+        w.u32(static_cast<VkCullModeFlags>(desc.cullMode));
+        w.u32(static_cast<uint32_t>(desc.frontFace));
+
+        w.u32(desc.depthTest);
+        w.u32(desc.depthWrite);
+        w.u32(static_cast<uint32_t>(desc.depthCompare));
+
+        w.u32(desc.blendEnable);
+        w.u32(static_cast<uint32_t>(desc.srcColorBlend));
+        w.u32(static_cast<uint32_t>(desc.dstColorBlend));
+        w.u32(static_cast<uint32_t>(desc.colorBlendOp));
+        w.u32(static_cast<uint32_t>(desc.srcAlphaBlend));
+        w.u32(static_cast<uint32_t>(desc.dstAlphaBlend));
+        w.u32(static_cast<uint32_t>(desc.alphaBlendOp));
+        w.u32(static_cast<VkColorComponentFlags>(desc.colorWriteMask));
+
+        w.u32(static_cast<uint32_t>(desc.colorFormat));
+        w.u32(static_cast<uint32_t>(desc.depthFormat));
+
+        w.u32(static_cast<uint32_t>(desc.pushConstantRanges.size()));
+        for (const auto& range : desc.pushConstantRanges) {
+            w.u32(static_cast<VkShaderStageFlags>(range.stageFlags));
+            w.u32(range.offset);
+            w.u32(range.size);
+        }
+
+        w.u32(static_cast<uint32_t>(desc.specEntries.size()));
+        for (const auto& entry : desc.specEntries) {
+            w.u32(entry.constantID);
+            w.u32(entry.offset);
+            w.u32(static_cast<uint32_t>(entry.size));
+        }
+        w.u32(static_cast<uint32_t>(desc.specData.size()));
+        bytes.insert(bytes.end(), desc.specData.begin(), desc.specData.end());
+        return bytes;
+    }
+
+    // False if the entry is malformed or names a shader the registry does not know
+    static bool deserialize(const std::vector<uint8_t>& bytes, const ShaderRegistry& shaders,
+        PipelineDesc& desc) {
+        Reader r{ bytes.data(), bytes.size() };
+
+        desc.vertCode = shaders.find(r.u64());
+        desc.fragCode = shaders.find(r.u64());
+        if (desc.vertCode.words.empty() || desc.fragCode.words.empty()) {
+            return false;
+        }
+
+        desc.vertexBindings.resize(r.count(3 * sizeof(uint32_t)));
+        for (auto& b : desc.vertexBindings) {
+            b.binding = r.u32();
+            b.stride = r.u32();
+            b.inputRate = static_cast<vk::VertexInputRate>(r.u32());
+        }
+        desc.vertexAttributes.resize(r.count(4 * sizeof(uint32_t)));
+        for (auto& a : desc.vertexAttributes) {
+            a.location = r.u32();
+            a.binding = r.u32();
+            a.format = static_cast<vk::Format>(r.u32());
+            a.offset = r.u32();
+        }
+        desc.topology = static_cast<vk::PrimitiveTopology>(r.u32());
+
+        desc.polygonMode = static_cast<vk::PolygonMode>(r.u32());
+        desc.cullMode = static_cast<vk::CullModeFlags>(r.u32());
+        desc.frontFace = static_cast<vk::FrontFace>(r.u32());
+
+        desc.depthTest = r.u32() != 0;
+        desc.depthWrite = r.u32() != 0;
+        desc.depthCompare = static_cast<vk::CompareOp>(r.u32());
+
+        desc.blendEnable = r.u32() != 0;
+        desc.srcColorBlend = static_cast<vk::BlendFactor>(r.u32());
+        desc.dstColorBlend = static_cast<vk::BlendFactor>(r.u32());
+        desc.colorBlendOp = static_cast<vk::BlendOp>(r.u32());
+        desc.srcAlphaBlend = static_cast<vk::BlendFactor>(r.u32());
+        desc.dstAlphaBlend = static_cast<vk::BlendFactor>(r.u32());
+        desc.alphaBlendOp = static_cast<vk::BlendOp>(r.u32());
+        desc.colorWriteMask = static_cast<vk::ColorComponentFlags>(r.u32());
+
+        desc.colorFormat = static_cast<vk::Format>(r.u32());
+        desc.depthFormat = static_cast<vk::Format>(r.u32());
+
+        desc.pushConstantRanges.resize(r.count(3 * sizeof(uint32_t)));
+        for (auto& range : desc.pushConstantRanges) {
+            range.stageFlags = static_cast<vk::ShaderStageFlags>(r.u32());
+            range.offset = r.u32();
+            range.size = r.u32();
+        }
+
+        desc.specEntries.resize(r.count(3 * sizeof(uint32_t)));
+        for (auto& entry : desc.specEntries) {
+            entry.constantID = r.u32();
+            entry.offset = r.u32();
+            entry.size = r.u32();
+        }
+        desc.specData.resize(r.count(1));
+        for (auto& byte : desc.specData) {
+            byte = r.get<uint8_t>();
+        }
+
+        // Specialization entries must stay inside the data they index
+        for (const auto& entry : desc.specEntries) {
+            if (entry.offset > desc.specData.size() || entry.size > desc.specData.size() - entry.offset) {
+                return false;
+            }
+        }
+        return r.ok && r.offset == bytes.size();
+    }
+
+    uint64_t ShaderRegistry::key(ShaderCode code) {
+        return hashBytes(code.words.data(), code.words.size_bytes());
+    }
+
+    void ShaderRegistry::add(ShaderCode code) {
+        shaders[key(code)] = code;
+    }
+
+    ShaderCode ShaderRegistry::find(uint64_t hash) const {
+        auto it = shaders.find(hash);
+        return it != shaders.end() ? it->second : ShaderCode();
+    }
+
+    void PipelineManifest::record(const PipelineDesc& desc) {
+        uint64_t key = desc.hash();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (recorded.count(key)) {
+                return;
+            }
+        }
+
+        // Serialize outside the lock; a racing record of the same desc is dropped below
+        auto bytes = serialize(desc);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (recorded.insert(key).second) {
+            entries.push_back({ key, std::move(bytes) });
+        }
+    }
+
+    bool PipelineManifest::load(const std::string& path) {
+        std::vector<Entry> loaded;
+        try {
+            MappedFile file = MappedFile::open(path);
+            Reader r{ reinterpret_cast<const uint8_t*>(file.data()), file.size() };
+
+            uint32_t magic = r.u32();
+            uint32_t version = r.u32();
+            uint32_t count = r.u32();
+            uint64_t checksum = r.u64();
+            if (!r.ok || magic != MANIFEST_MAGIC || version != MANIFEST_VERSION ||
+                checksum != hashBytes(r.data + r.offset, r.size - r.offset)) {
+                return false;
+            }
+
+            for (uint32_t i = 0; i < count && r.ok; i++) {
+                Entry entry;
+                entry.key = r.u64();
+                uint32_t length = r.count(1);
+                entry.bytes.assign(r.data + r.offset, r.data + r.offset + length);
+                r.offset += length;
+                loaded.push_back(std::move(entry));
+            }
+            if (!r.ok || r.offset != r.size) {
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            // No manifest yet; the first launch simply has nothing to warm up
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        recorded.clear();
+        for (const auto& entry : loaded) {
+            recorded.insert(entry.key);
+        }
+        entries = std::move(loaded);
+        return true;
+    }
+
+    bool PipelineManifest::save(const std::string& path) const {
+        std::vector<uint8_t> payload;
+        uint32_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Writer w{ payload };
+            for (const auto& entry : entries) {
+                w.u64(entry.key);
+                w.u32(static_cast<uint32_t>(entry.bytes.size()));
+                payload.insert(payload.end(), entry.bytes.begin(), entry.bytes.end());
+            }
+            count = static_cast<uint32_t>(entries.size());
+        }
+
+        std::vector<uint8_t> header;
+        Writer w{ header };
+        w.u32(MANIFEST_MAGIC);
+        w.u32(MANIFEST_VERSION);
+        w.u32(count);
+        w.u64(hashBytes(payload.data(), payload.size()));
+
+        // Write beside the target and rename over it so a crash never leaves a torn file
+        const std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(header.data()), header.size());
+            file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+            if (!file) {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    size_t PipelineManifest::replay(PipelineCompiler& compiler, const ShaderRegistry& shaders) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t queued = 0;
+        for (const auto& entry : entries) {
+            PipelineDesc desc;
+            if (!deserialize(entry.bytes, shaders, desc)) {
+                continue;
+            }
+            // Failures surface through the future, which nobody waits on; the frame that
+            // needs the pipeline will see the error from getOrCreate instead
+            compiler.compileAsync(desc);
+            queued++;
+        }
+        return queued;
+    }
+
+    size_t PipelineManifest::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+} // namespace VulkanCube
@@ -0,0 +1,568 @@
+#include "../pch.h"
+#include "../include/vulkanreflection.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace VulkanCube {
+
+    // Opcodes, decorations and enums from the SPIR-V specification, section 3
+    namespace spv {
+        constexpr uint32_t MAGIC = 0x07230203;
+        constexpr size_t HEADER_WORDS = 5;
+
+        enum Op : uint32_t {
+            OpEntryPoint = 15,
+            OpTypeVoid = 19,
+            OpTypeBool = 20,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpSpecConstantTrue = 48,
+            OpSpecConstantFalse = 49,
+            OpSpecConstant = 50,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72,
+            OpTypeAccelerationStructureKHR = 5341,
+        };
+
+        enum Decoration : uint32_t {
+            SpecId = 1,
+            Block = 2,
+            BufferBlock = 3,
+            ArrayStride = 6,
+            MatrixStride = 7,
+            BuiltIn = 11,
+            Location = 30,
+            Binding = 33,
+            DescriptorSet = 34,
+            Offset = 35,
+        };
+
+        enum StorageClass : uint32_t {
+            UniformConstant = 0,
+            Input = 1,
+            Uniform = 2,
+            PushConstant = 9,
+            StorageBuffer = 12,
+        };
+
+        enum Dim : uint32_t {
+            DimBuffer = 5,
+            DimSubpassData = 6,
+        };
+    }
+
+    namespace {
+        struct Decorations {
+            std::optional<uint32_t> set;
+            std::optional<uint32_t> binding;
+            std::optional<uint32_t> location;
+            std::optional<uint32_t> specId;
+            bool block = false;
+            bool bufferBlock = false;
+            bool builtIn = false;
+            uint32_t arrayStride = 0;
+            std::vector<uint32_t> memberOffsets;
+            std::vector<uint32_t> memberMatrixStrides;
+        };
+
+        // The defining instruction of every result id, plus its decorations
+        struct Module {
+            std::vector<std::span<const uint32_t>> defs;
+            std::vector<Decorations> decorations;
+            std::vector<uint32_t> variables;
+            std::vector<uint32_t> specConstants;
+            std::optional<uint32_t> executionModel;
+
+            explicit Module(std::span<const uint32_t> code);
+
+            std::span<const uint32_t> def(uint32_t id) const;
+            uint32_t opcode(uint32_t id) const { return def(id)[0] & 0xFFFF; }
+            uint32_t constant(uint32_t id) const;
+            uint32_t typeSize(uint32_t type) const;
+            uint32_t memberSize(uint32_t structType, uint32_t member) const;
+            vk::Format format(uint32_t type) const;
+        };
+
+        [[noreturn]] void malformed(const char* what) {
+            throw std::runtime_error(std::string("Malformed SPIR-V: ") + what);
+        }
+
+        Module::Module(std::span<const uint32_t> code) {
+            if (code.size() < spv::HEADER_WORDS || code[0] != spv::MAGIC) {
+                malformed("bad header");
+            }
+
+            // Every id needs a defining instruction, so a bound past the
+            // word count is corrupt and must not drive the allocations below
+            uint32_t bound = code[3];
+            if (bound > code.size()) {
+                malformed("id bound exceeds module size");
+            }
+            defs.resize(bound);
+            decorations.resize(bound);
+
+            auto record = [&](uint32_t id, std::span<const uint32_t> instr) {
+                if (id >= bound) {
+                    malformed("id out of bounds");
+                }
+                defs[id] = instr;
+            };
+
+            for (size_t i = spv::HEADER_WORDS; i < code.size();) {
+                uint32_t wordCount = code[i] >> 16;
+                uint32_t op = code[i] & 0xFFFF;
+                if (wordCount == 0 || i + wordCount > code.size()) {
+                    malformed("truncated instruction");
+                }
+                auto instr = code.subspan(i, wordCount);
+                i += wordCount;
+
+                switch (op) {
+                case spv::OpEntryPoint:
+                    if (wordCount < 3) malformed("short OpEntryPoint");
+                    if (!executionModel) executionModel = instr[1];
+                    break;
+
+                case spv::OpTypeVoid:
+                case spv::OpTypeBool:
+                case spv::OpTypeInt:
+                case spv::OpTypeFloat:
+                case spv::OpTypeVector:
+                case spv::OpTypeMatrix:
+                case spv::OpTypeImage:
+                case spv::OpTypeSampler:
+                case spv::OpTypeSampledImage:
+                case spv::OpTypeArray:
+                case spv::OpTypeRuntimeArray:
+                case spv::OpTypeStruct:
+                case spv::OpTypePointer:
+                case spv::OpTypeAccelerationStructureKHR:
+                    if (wordCount < 2) malformed("short type declaration");
+                    record(instr[1], instr);
+                    break;
+
+                case spv::OpConstant:
+                case spv::OpSpecConstantTrue:
+                case spv::OpSpecConstantFalse:
+                case spv::OpSpecConstant:
+                case spv::OpVariable:
+                    if (wordCount < 3) malformed("short constant or variable");
+                    record(instr[2], instr);
+                    if (op == spv::OpVariable) {
+                        variables.push_back(instr[2]);
+                    }
+                    else if (op != spv::OpConstant) {
+                        specConstants.push_back(instr[2]);
+                    }
+                    break;
+
+                case spv::OpDecorate: {
+                    if (wordCount < 3) malformed("short OpDecorate");
+                    if (instr[1] >= bound) malformed("id out of bounds");
+                    Decorations& d = decorations[instr[1]];
+                    uint32_t value = wordCount > 3 ? instr[3] : 0;
+                    switch (instr[2]) {
+                    case spv::SpecId: d.specId = value; break;
+                    case spv::Block: d.block = true; break;
+                    case spv::BufferBlock: d.bufferBlock = true; break;
+                    case spv::ArrayStride: d.arrayStride = value; break;
+                    case spv::BuiltIn: d.builtIn = true; break;
+                    case spv::Location: d.location = value; break;
+                    case spv::Binding: d.binding = value; break;
+                    case spv::DescriptorSet: d.set = value; break;
+                    }
+                    break;
+                }
+
+                case spv::OpMemberDecorate: {
+                    if (wordCount < 4) malformed("short OpMemberDecorate");
+                    if (instr[1] >= bound) malformed("id out of bounds");
+                    Decorations& d = decorations[instr[1]];
+                    uint32_t member = instr[2];
+                    // A struct cannot have more members than the module has words
+                    if (member >= code.size()) malformed("member index out of bounds");
+                    uint32_t value = wordCount > 4 ? instr[4] : 0;
+                    auto set = [member, value](std::vector<uint32_t>& values) {
+                        if (values.size() <= member) values.resize(member + 1, 0);
+                        values[member] = value;
+                    };
+                    switch (instr[3]) {
+                    case spv::Offset: set(d.memberOffsets); break;
+                    case spv::MatrixStride: set(d.memberMatrixStrides); break;
+                    case spv::BuiltIn: d.builtIn = true; break;
+                    }
+                    break;
+                }
+                }
+            }
+        }
+
+        std::span<const uint32_t> Module::def(uint32_t id) const {
+            if (id >= defs.size() || defs[id].empty()) {
+                malformed("reference to undeclared id");
+            }
+            return defs[id];
+        }
+
+        uint32_t Module::constant(uint32_t id) const {
+            auto instr = def(id);
+            if ((instr[0] & 0xFFFF) != spv::OpConstant || instr.size() < 4) {
+                malformed("array length is not a constant");
+            }
+            return instr[3];
+        }
+
+        uint32_t Module::typeSize(uint32_t type) const {
+            auto instr = def(type);
+            switch (instr[0] & 0xFFFF) {
+            case spv::OpTypeBool:
+                return 4;
+            case spv::OpTypeInt:
+            case spv::OpTypeFloat:
+                return instr[2] / 8;
+            case spv::OpTypeVector:
+            case spv::OpTypeMatrix:
+                return instr[3] * typeSize(instr[2]);
+            case spv::OpTypeArray: {
+                uint32_t stride = decorations[type].arrayStride;
+                return constant(instr[3]) * (stride ? stride : typeSize(instr[2]));
+            }
+            case spv::OpTypeStruct: {
+                uint32_t size = 0;
+                uint32_t memberCount = static_cast<uint32_t>(instr.size() - 2);
+                const auto& offsets = decorations[type].memberOffsets;
+                for (uint32_t m = 0; m < memberCount; m++) {
+                    uint32_t offset = m < offsets.size() ? offsets[m] : size;
+                    size = std::max(size, offset + memberSize(type, m));
+                }
+                return size;
+            }
+            default:
+                return 0;
+            }
+        }
+
+        uint32_t Module::memberSize(uint32_t structType, uint32_t member) const {
+            uint32_t type = def(structType)[2 + member];
+            const auto& strides = decorations[structType].memberMatrixStrides;
+            if (opcode(type) == spv::OpTypeMatrix && member < strides.size() && strides[member]) {
+                return def(type)[3] * strides[member];
+            }
+            return typeSize(type);
+        }
+
+        vk::Format Module::format(uint32_t type) const {
+            auto instr = def(type);
+            uint32_t op = instr[0] & 0xFFFF;
+            uint32_t components = 1;
+            if (op == spv::OpTypeVector) {
+                components = instr[3];
+                instr = def(instr[2]);
+                op = instr[0] & 0xFFFF;
+            }
+            if (components < 1 || components > 4) {
+                return vk::Format::eUndefined;
+            }
+
+            static constexpr vk::Format float32[] = {
+                vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+            static constexpr vk::Format float64[] = {
+                vk::Format::eR64Sfloat, vk::Format::eR64G64Sfloat,
+                vk::Format::eR64G64B64Sfloat, vk::Format::eR64G64B64A64Sfloat };
+            static constexpr vk::Format sint32[] = {
+                vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+                vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint };
+            static constexpr vk::Format uint32[] = {
+                vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+                vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint };
+
+            if (op == spv::OpTypeFloat && instr[2] == 32) return float32[components - 1];
+            if (op == spv::OpTypeFloat && instr[2] == 64) return float64[components - 1];
+            if (op == spv::OpTypeInt && instr[2] == 32) {
+                return instr[3] ? sint32[components - 1] : uint32[components - 1];
+            }
+            return vk::Format::eUndefined;
+        }
+
+        vk::ShaderStageFlagBits stageOf(uint32_t executionModel) {
+            switch (executionModel) {
+            case 0: return vk::ShaderStageFlagBits::eVertex;
+            case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+            case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+            case 3: return vk::ShaderStageFlagBits::eGeometry;
+            case 4: return vk::ShaderStageFlagBits::eFragment;
+            case 5: return vk::ShaderStageFlagBits::eCompute;
+            default: throw std::runtime_error("Unsupported SPIR-V execution model");
+            }
+        }
+
+        // Descriptor type for a resource variable's pointee, after arrays are stripped
+        std::optional<vk::DescriptorType> descriptorType(const Module& module,
+            uint32_t storageClass, uint32_t type) {
+            auto instr = module.def(type);
+            switch (instr[0] & 0xFFFF) {
+            case spv::OpTypeSampledImage:
+                return vk::DescriptorType::eCombinedImageSampler;
+            case spv::OpTypeSampler:
+                return vk::DescriptorType::eSampler;
+            case spv::OpTypeImage: {
+                if (instr.size() < 9) malformed("short OpTypeImage");
+                bool storage = instr[7] == 2;
+                if (instr[3] == spv::DimBuffer) {
+                    return storage ? vk::DescriptorType::eStorageTexelBuffer
+                        : vk::DescriptorType::eUniformTexelBuffer;
+                }
+                if (instr[3] == spv::DimSubpassData) {
+                    return vk::DescriptorType::eInputAttachment;
+                }
+                return storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+            }
+            case spv::OpTypeAccelerationStructureKHR:
+                return vk::DescriptorType::eAccelerationStructureKHR;
+            case spv::OpTypeStruct:
+                if (storageClass == spv::StorageBuffer || module.decorations[type].bufferBlock) {
+                    return vk::DescriptorType::eStorageBuffer;
+                }
+                if (storageClass == spv::Uniform) {
+                    return vk::DescriptorType::eUniformBuffer;
+                }
+                return std::nullopt;
+            default:
+                return std::nullopt;
+            }
+        }
+    }
+
+    ShaderReflection ShaderReflection::reflect(std::span<const uint32_t> code) {
+        Module module(code);
+        if (!module.executionModel) {
+            malformed("no entry point");
+        }
+
+        ShaderReflection refl;
+        vk::ShaderStageFlagBits stage = stageOf(*module.executionModel);
+        refl.stages = stage;
+
+        for (uint32_t var : module.variables) {
+            auto instr = module.def(var);
+            auto pointer = module.def(instr[1]);
+            if (instr.size() < 4 || (pointer[0] & 0xFFFF) != spv::OpTypePointer || pointer.size() < 4) {
+                malformed("variable is not a pointer");
+            }
+            uint32_t storageClass = instr[3];
+            uint32_t type = pointer[3];
+            const Decorations& deco = module.decorations[var];
+
+            switch (storageClass) {
+            case spv::UniformConstant:
+            case spv::Uniform:
+            case spv::StorageBuffer: {
+                if (!deco.binding) {
+                    break;
+                }
+
+                // Arrays of resources become one binding with descriptorCount > 1
+                uint32_t count = 1;
+                for (;;) {
+                    uint32_t op = module.opcode(type);
+                    if (op == spv::OpTypeArray) {
+                        count *= module.constant(module.def(type)[3]);
+                    }
+                    else if (op == spv::OpTypeRuntimeArray) {
+                        count = 0;
+                    }
+                    else {
+                        break;
+                    }
+                    type = module.def(type)[2];
+                }
+
+                auto descType = descriptorType(module, storageClass, type);
+                if (descType) {
+                    refl.bindings.push_back({ deco.set.value_or(0), *deco.binding, *descType, count, stage });
+                }
+                break;
+            }
+
+            case spv::PushConstant: {
+                const auto& offsets = module.decorations[type].memberOffsets;
+                uint32_t offset = offsets.empty() ? 0 : *std::min_element(offsets.begin(), offsets.end());
+                uint32_t size = module.typeSize(type);
+                if (size > offset) {
+                    refl.pushConstantRanges.push_back({ stage, offset, size - offset });
+                }
+                break;
+            }
+
+            case spv::Input: {
+                // Built-ins and interface blocks never come from a vertex buffer
+                if (deco.builtIn || module.decorations[type].builtIn || !deco.location ||
+                    module.opcode(type) == spv::OpTypeStruct) {
+                    break;
+                }
+
+                // Matrices and arrays take one location per column or element
+                uint32_t locations = 1;
+                uint32_t op = module.opcode(type);
+                if (op == spv::OpTypeMatrix) {
+                    locations = module.def(type)[3];
+                    type = module.def(type)[2];
+                }
+                else if (op == spv::OpTypeArray) {
+                    locations = module.constant(module.def(type)[3]);
+                    type = module.def(type)[2];
+                }
+
+                for (uint32_t i = 0; i < locations; i++) {
+                    refl.inputs.push_back({ *deco.location + i, module.format(type), module.typeSize(type) });
+                }
+                break;
+            }
+            }
+        }
+
+        for (uint32_t id : module.specConstants) {
+            const Decorations& deco = module.decorations[id];
+            if (!deco.specId) {
+                continue;
+            }
+
+            auto instr = module.def(id);
+            auto type = module.def(instr[1]);
+            SpecConstant constant;
+            constant.id = *deco.specId;
+            switch (instr[0] & 0xFFFF) {
+            case spv::OpSpecConstantTrue:
+            case spv::OpSpecConstantFalse:
+                constant.type = SpecConstant::Type::Bool;
+                constant.defaultValue = (instr[0] & 0xFFFF) == spv::OpSpecConstantTrue;
+                constant.size = sizeof(vk::Bool32);
+                break;
+            default:
+                if ((type[0] & 0xFFFF) == spv::OpTypeFloat) {
+                    constant.type = SpecConstant::Type::Float;
+                }
+                else {
+                    constant.type = type[3] ? SpecConstant::Type::Int : SpecConstant::Type::UInt;
+                }
+                constant.defaultValue = instr.size() > 3 ? instr[3] : 0;
+                constant.size = type[2] / 8;
+                break;
+            }
+            refl.specConstants.push_back(constant);
+        }
+
+        std::sort(refl.bindings.begin(), refl.bindings.end(), [](const auto& a, const auto& b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+        std::sort(refl.inputs.begin(), refl.inputs.end(), [](const auto& a, const auto& b) {
+            return a.location < b.location;
+        });
+        std::sort(refl.specConstants.begin(), refl.specConstants.end(), [](const auto& a, const auto& b) {
+            return a.id < b.id;
+        });
+        return refl;
+    }
+
+    void ShaderReflection::merge(const ShaderReflection& other) {
+        for (const auto& incoming : other.bindings) {
+            auto it = std::find_if(bindings.begin(), bindings.end(), [&](const DescriptorBinding& b) {
+                return b.set == incoming.set && b.binding == incoming.binding;
+            });
+            if (it == bindings.end()) {
+                bindings.push_back(incoming);
+            }
+            else if (it->type != incoming.type || it->count != incoming.count) {
+                throw std::runtime_error("Shader stages disagree on set " + std::to_string(incoming.set) +
+                    ", binding " + std::to_string(incoming.binding));
+            }
+            else {
+                it->stages |= incoming.stages;
+            }
+        }
+        std::sort(bindings.begin(), bindings.end(), [](const auto& a, const auto& b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+
+        // A stage may appear in only one range, so one range covers every stage's block
+        if (!other.pushConstantRanges.empty()) {
+            std::vector<vk::PushConstantRange> all = pushConstantRanges;
+            all.insert(all.end(), other.pushConstantRanges.begin(), other.pushConstantRanges.end());
+
+            vk::ShaderStageFlags rangeStages;
+            uint32_t begin = all.front().offset;
+            uint32_t end = all.front().offset + all.front().size;
+            for (const auto& range : all) {
+                begin = std::min(begin, range.offset);
+                end = std::max(end, range.offset + range.size);
+                rangeStages |= range.stageFlags;
+            }
+            pushConstantRanges = { { rangeStages, begin, end - begin } };
+        }
+
+        for (const auto& constant : other.specConstants) {
+            bool known = std::any_of(specConstants.begin(), specConstants.end(),
+                [&](const SpecConstant& c) { return c.id == constant.id; });
+            if (!known) {
+                specConstants.push_back(constant);
+            }
+        }
+        std::sort(specConstants.begin(), specConstants.end(), [](const auto& a, const auto& b) {
+            return a.id < b.id;
+        });
+
+        if (other.stages & vk::ShaderStageFlagBits::eVertex) {
+            inputs = other.inputs;
+        }
+        stages |= other.stages;
+    }
+
+    uint32_t ShaderReflection::setCount() const {
+        return bindings.empty() ? 0 : bindings.back().set + 1;
+    }
+
+    std::vector<vk::DescriptorSetLayoutBinding> ShaderReflection::setLayoutBindings(uint32_t set) const {
+        std::vector<vk::DescriptorSetLayoutBinding> result;
+        for (const auto& b : bindings) {
+            if (b.set == set) {
+                result.push_back({ b.binding, b.type, b.count, b.stages });
+            }
+        }
+        return result;
+    }
+
+    void ShaderReflection::vertexInput(std::vector<vk::VertexInputBindingDescription>& bindingDescs,
+        std::vector<vk::VertexInputAttributeDescription>& attributeDescs, uint32_t binding) const {
+        bindingDescs.clear();
+        attributeDescs.clear();
+        if (inputs.empty()) {
+            return;
+        }
+
+        uint32_t offset = 0;
+        for (const auto& input : inputs) {
+            if (input.format == vk::Format::eUndefined) {
+                throw std::runtime_error("Vertex input at location " + std::to_string(input.location) +
+                    " has no matching vertex format");
+            }
+            attributeDescs.push_back({ input.location, binding, input.format, offset });
+            offset += input.size;
+        }
+        bindingDescs.push_back({ binding, offset, vk::VertexInputRate::eVertex });
+    }
+} // namespace VulkanCube
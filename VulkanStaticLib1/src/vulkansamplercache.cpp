@@ -0,0 +1,58 @@
+#include "../pch.h"
+#include "../include/vulkancore.hpp"
+#include "../include/vulkanhash.hpp"
+
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    SamplerCache::SamplerCache(vk::Device device) : device(device) {
+    }
+
+    size_t SamplerCache::KeyHash::operator()(const vk::SamplerCreateInfo& info) const {
+        // Equality compares floats by value, so -0.0f must hash like 0.0f; adding +0.0f
+        // turns -0.0f into +0.0f and leaves every other value unchanged
+        auto normalized = [](float v) { return v + 0.0f; };
+        Hasher h;
+        h.add(static_cast<VkSamplerCreateFlags>(info.flags))
+            .add(info.magFilter).add(info.minFilter).add(info.mipmapMode)
+            .add(info.addressModeU).add(info.addressModeV).add(info.addressModeW)
+            .add(normalized(info.mipLodBias)).add(info.anisotropyEnable).add(normalized(info.maxAnisotropy))
+            .add(info.compareEnable).add(info.compareOp)
+            .add(normalized(info.minLod)).add(normalized(info.maxLod))
+            .add(info.borderColor).add(info.unnormalizedCoordinates);
+        return static_cast<size_t>(h.value());
+    }
+
+    vk::Sampler SamplerCache::get(const vk::SamplerCreateInfo& info) {
+        if (info.pNext) {
+            throw std::runtime_error("SamplerCache cannot key chained sampler state");
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = samplers.find(info);
+        if (it != samplers.end()) {
+            hitCount++;
+            return *it->second;
+        }
+
+        auto result = device.createSamplerUnique(info);
+        if (result.result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to create texture sampler!");
+        }
+
+        vk::Sampler sampler = *result.value;
+        samplers.emplace(info, std::move(result.value));
+        return sampler;
+    }
+
+    uint64_t SamplerCache::hits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hitCount;
+    }
+
+    size_t SamplerCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return samplers.size();
+    }
+} // namespace VulkanCube
@@ -0,0 +1,248 @@
+#include "../pch.h"
+#include "../include/vulkanshaderreload.hpp"
+#include "../include/vulkanhash.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace VulkanCube {
+
+    // How long the watcher sleeps between checks, and lets an editor finish writing
+    static constexpr auto RELOAD_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+    static std::filesystem::path normalizePath(const std::filesystem::path& path) {
+        std::error_code ec;
+        auto result = std::filesystem::weakly_canonical(path, ec);
+        return ec ? path : result;
+    }
+
+    // Unique per source file and per process, so same-named shaders in different
+    // directories, or two running instances, never share a compiler output
+    static std::filesystem::path reloadOutputPath(const std::filesystem::path& source) {
+#ifdef _WIN32
+        uint64_t pid = static_cast<uint64_t>(_getpid());
+#else
+        uint64_t pid = static_cast<uint64_t>(getpid());
+#endif
+        std::string full = source.string();
+        uint64_t hash = Hasher().bytes(full.data(), full.size()).add(pid).value();
+        return std::filesystem::temp_directory_path() /
+            (source.filename().string() + "." + std::to_string(hash) + ".reload.spv");
+    }
+
+    ShaderReloader::ShaderReloader(const Context& ctx, PipelineStateCache& cache, std::string compiler,
+        ErrorCallback onError)
+        : ctx(ctx), cache(cache), compiler(std::move(compiler)), onError(std::move(onError)) {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) {
+            throw std::runtime_error("Failed to initialize inotify!");
+        }
+#endif
+        thread = std::thread([this] { run(); });
+    }
+
+    ShaderReloader::~ShaderReloader() {
+        stopping = true;
+        thread.join();
+
+#ifdef __linux__
+        close(inotifyFd);
+#endif
+
+        // Cache keys that point into reloaded code must go before the code does
+        for (const auto& swap : ready) {
+            cache.erase(swap.state.desc);
+        }
+        for (const auto& watch : watches) {
+            if (watch.installed.vertCode || watch.installed.fragCode) {
+                cache.erase(watch.installed.desc);
+            }
+        }
+    }
+
+    void ShaderReloader::watch(Handle& slot, const PipelineDesc& desc,
+        const std::filesystem::path& vertPath, const std::filesystem::path& fragPath) {
+        Watch entry{ &slot, normalizePath(vertPath), normalizePath(fragPath), { desc }, { desc } };
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& path : { entry.vertPath, entry.fragPath }) {
+#ifdef __linux__
+            // Watch the directory: editors often save by writing a new file and renaming it
+            auto directory = path.parent_path();
+            int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd < 0) {
+                throw std::runtime_error("Failed to watch shader directory: " + directory.string());
+            }
+            directories[wd] = directory;
+#else
+            std::error_code ec;
+            writeTimes[path.string()] = std::filesystem::last_write_time(path, ec);
+#endif
+        }
+        watches.push_back(std::move(entry));
+    }
+
+    bool ShaderReloader::update() {
+        frame++;
+        while (!retired.empty() && retired.front().releaseFrame <= frame) {
+            retired.pop_front();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        bool swapped = false;
+        for (auto& swap : ready) {
+            Watch& watch = watches[swap.watch];
+            if (swap.pipeline == *watch.slot) {
+                // Saved without a real change; the cache handed back the same pipeline
+                continue;
+            }
+
+            // The old pipeline may still be referenced by frames in flight
+            cache.erase(watch.installed.desc);
+            retired.push_back({ std::move(watch.installed), std::move(*watch.slot),
+                frame + Context::MAX_FRAMES_IN_FLIGHT });
+
+            *watch.slot = std::move(swap.pipeline);
+            watch.installed = std::move(swap.state);
+            swapped = true;
+        }
+        ready.clear();
+        return swapped;
+    }
+
+    void ShaderReloader::run() {
+        while (!stopping) {
+            std::set<std::filesystem::path> changed;
+
+#ifdef __linux__
+            pollfd pfd{ inotifyFd, POLLIN, 0 };
+            if (::poll(&pfd, 1, static_cast<int>(RELOAD_POLL_INTERVAL.count())) <= 0) {
+                continue;
+            }
+
+            // Let the editor finish, then drain everything that queued up
+            std::this_thread::sleep_for(RELOAD_POLL_INTERVAL);
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (char* p = buffer; p < buffer + length;) {
+                    auto* event = reinterpret_cast<inotify_event*>(p);
+                    auto it = directories.find(event->wd);
+                    if (event->len > 0 && it != directories.end()) {
+                        changed.insert(normalizePath(it->second / event->name));
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+#else
+            std::this_thread::sleep_for(RELOAD_POLL_INTERVAL);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& [path, writeTime] : writeTimes) {
+                    std::error_code ec;
+                    auto current = std::filesystem::last_write_time(path, ec);
+                    if (!ec && current != writeTime) {
+                        writeTime = current;
+                        changed.insert(path);
+                    }
+                }
+            }
+#endif
+
+            for (const auto& path : changed) {
+                rebuild(path);
+            }
+        }
+    }
+
+    void ShaderReloader::rebuild(const std::filesystem::path& changed) {
+        std::vector<size_t> affected;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < watches.size(); i++) {
+                if (watches[i].vertPath == changed || watches[i].fragPath == changed) {
+                    affected.push_back(i);
+                }
+            }
+        }
+        if (affected.empty()) {
+            return;
+        }
+
+        // A broken edit keeps the current pipeline; fix the shader and save again
+        Code code;
+        try {
+            code = compile(changed);
+        }
+        catch (const std::exception& e) {
+            if (onError) onError(e.what());
+            return;
+        }
+
+        for (size_t index : affected) {
+            Installed state;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                Watch& watch = watches[index];
+                if (watch.vertPath == changed) {
+                    watch.latest.vertCode = code;
+                    watch.latest.desc.vertCode = *code;
+                }
+                if (watch.fragPath == changed) {
+                    watch.latest.fragCode = code;
+                    watch.latest.desc.fragCode = *code;
+                }
+                state = watch.latest;
+            }
+
+            try {
+                Handle pipeline = cache.getOrCreate(ctx, state.desc);
+                if (!pipeline || !pipeline->pipeline) {
+                    throw std::runtime_error("Failed to create graphics pipeline!");
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.push_back({ index, std::move(state), std::move(pipeline) });
+            }
+            catch (const std::exception& e) {
+                if (onError) onError(changed.string() + ": " + e.what());
+            }
+        }
+    }
+
+    ShaderReloader::Code ShaderReloader::compile(const std::filesystem::path& path) const {
+        if (path.extension() == ".spv") {
+            return std::make_shared<const std::vector<uint32_t>>(readSpirvFile(path.string()));
+        }
+
+        auto output = reloadOutputPath(path);
+        std::string command = "\"" + compiler + "\" -V \"" + path.string() + "\" -o \"" + output.string() + "\"";
+#ifdef _WIN32
+        // cmd.exe strips the outer quotes, keeping the quoted paths intact
+        command = "\"" + command + "\"";
+#endif
+        if (std::system(command.c_str()) != 0) {
+            std::error_code ec;
+            std::filesystem::remove(output, ec);
+            throw std::runtime_error("Failed to compile " + path.string());
+        }
+        auto code = std::make_shared<const std::vector<uint32_t>>(readSpirvFile(output.string()));
+        std::error_code ec;
+        std::filesystem::remove(output, ec);
+        return code;
+    }
+} // namespace VulkanCube
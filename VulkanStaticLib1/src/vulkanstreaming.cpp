@@ -0,0 +1,337 @@
+#include "../pch.h"
+#include "../include/vulkanstreaming.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace VulkanCube {
+
+    std::span<const std::byte> TextureStreamer::Source::level(uint32_t level) const {
+        if (ktx) {
+            return ktx->levelData(level);
+        }
+        return std::as_bytes(std::span<const uint8_t>(rgbaLevels[level]));
+    }
+
+    vk::DeviceSize TextureStreamer::Source::bytesFrom(uint32_t first) const {
+        vk::DeviceSize bytes = 0;
+        for (uint32_t l = first; l < levelCount; l++) {
+            bytes += level(l).size();
+        }
+        return bytes;
+    }
+
+    TextureStreamer::TextureStreamer(const Context& ctx, vk::DeviceSize budgetBytes,
+        vk::DeviceSize uploadBytesPerUpdate)
+        : ctx(ctx), budget(budgetBytes), uploadPerUpdate(uploadBytesPerUpdate) {
+        // One sampler for every streamed texture; residency lives in the views
+        sharedSampler = ctx.samplerCache->get(textureSamplerInfo(ctx));
+    }
+
+    TextureStreamer::~TextureStreamer() = default;
+
+    TextureStreamer::Id TextureStreamer::add(const std::string& path) {
+        Entry entry;
+        Source& source = entry.source;
+
+        MappedFile file = MappedFile::open(path);
+        if (Ktx2File::isKtx2(file.bytes())) {
+            source.ktx = Ktx2File::parse(std::move(file), path);
+            if (!isTextureFormatSupported(ctx, source.ktx->format)) {
+                throw std::runtime_error("Texture format not supported by this device: " + path);
+            }
+            source.format = source.ktx->format;
+            source.width = source.ktx->width;
+            source.height = source.ktx->height;
+            source.levelCount = static_cast<uint32_t>(source.ktx->levels.size());
+        }
+        else {
+            int texWidth, texHeight, texChannels;
+            stbi_uc* pixels = stbi_load_from_memory(
+                reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!pixels) {
+                throw std::runtime_error("Failed to load texture image: " + path);
+            }
+
+            source.format = vk::Format::eR8G8B8A8Srgb;
+            source.width = static_cast<uint32_t>(texWidth);
+            source.height = static_cast<uint32_t>(texHeight);
+            source.levelCount = mipLevelCount(source.width, source.height);
+            source.rgbaLevels.resize(source.levelCount);
+            source.rgbaLevels[0].assign(pixels, pixels + size_t(texWidth) * texHeight * 4);
+            stbi_image_free(pixels);
+
+            for (uint32_t l = 1; l < source.levelCount; l++) {
+                uint32_t w = std::max(source.width >> l, 1u);
+                uint32_t h = std::max(source.height >> l, 1u);
+                source.rgbaLevels[l].resize(size_t(w) * h * 4);
+                downsampleRGBA8(source.rgbaLevels[l - 1].data(),
+                    std::max(source.width >> (l - 1), 1u), std::max(source.height >> (l - 1), 1u),
+                    source.rgbaLevels[l].data());
+            }
+        }
+
+        // The tail is everything up to TAIL_SIZE; a KTX2 file without small mips keeps its
+        // coarsest stored level resident instead
+        entry.tail = source.levelCount - 1;
+        for (uint32_t l = 0; l < source.levelCount; l++) {
+            if (std::max(source.width >> l, source.height >> l) <= TAIL_SIZE) {
+                entry.tail = l;
+                break;
+            }
+        }
+        entry.base = source.levelCount;
+        entry.wanted = entry.tail;
+        entry.lastUsed = frame;
+
+        Id id = nextId++;
+        entries.emplace(id, std::move(entry));
+        return id;
+    }
+
+    void TextureStreamer::remove(Id id) {
+        auto it = entries.find(id);
+        if (it == entries.end()) {
+            return;
+        }
+
+        Entry& entry = it->second;
+        if (entry.base < entry.source.levelCount) {
+            resident -= entry.source.bytesFrom(entry.base);
+            retired.push_back({ std::move(entry.image), {}, frame + Context::MAX_FRAMES_IN_FLIGHT });
+        }
+        entries.erase(it);
+    }
+
+    void TextureStreamer::request(Id id, float screenPixels) {
+        Entry& entry = entries.at(id);
+        const Source& source = entry.source;
+
+        // One texel per pixel: every halving of the on-screen size drops a level
+        float texels = static_cast<float>(std::max(source.width, source.height));
+        float ratio = texels / std::max(screenPixels, 1.0f);
+        uint32_t level = ratio > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(ratio))) : 0;
+
+        entry.wanted = std::min({ entry.wanted, level, entry.tail });
+        entry.lastUsed = frame;
+    }
+
+    std::vector<TextureStreamer::Id> TextureStreamer::update(vk::CommandBuffer cmd) {
+        while (!retired.empty() && retired.front().releaseFrame <= frame) {
+            retired.pop_front();
+        }
+
+        std::vector<Id> changed;
+
+        // New textures get their tail right away, outside the budget: it is what keeps
+        // every texture drawable
+        for (auto& [id, entry] : entries) {
+            if (entry.base == entry.source.levelCount) {
+                rebase(entry, entry.tail, cmd);
+                changed.push_back(id);
+            }
+        }
+
+        // Over budget: first drop levels finer than anything asked for since the last
+        // update, then the finest levels of the least recently requested textures
+        auto evictOne = [&](bool includeNeeded) {
+            Entry* victim = nullptr;
+            Id victimId = 0;
+            for (auto& [id, entry] : entries) {
+                bool needed = entry.lastUsed == frame && entry.base >= entry.wanted;
+                if (entry.base >= entry.tail || (needed && !includeNeeded)) {
+                    continue;
+                }
+                if (!victim || entry.lastUsed < victim->lastUsed) {
+                    victim = &entry;
+                    victimId = id;
+                }
+            }
+            if (victim) {
+                rebase(*victim, victim->base + 1, cmd);
+                changed.push_back(victimId);
+            }
+            return victim != nullptr;
+        };
+        while (resident > budget && evictOne(false)) {
+        }
+        while (resident > budget && evictOne(true)) {
+        }
+
+        // Stream in one finer level per texture, most recently requested first
+        std::vector<std::pair<Id, Entry*>> wanting;
+        for (auto& [id, entry] : entries) {
+            if (entry.wanted < entry.base) {
+                wanting.push_back({ id, &entry });
+            }
+        }
+        std::sort(wanting.begin(), wanting.end(), [](const auto& a, const auto& b) {
+            if (a.second->lastUsed != b.second->lastUsed) {
+                return a.second->lastUsed > b.second->lastUsed;
+            }
+            return a.second->base - a.second->wanted > b.second->base - b.second->wanted;
+        });
+
+        vk::DeviceSize uploaded = 0;
+        for (auto& [id, entry] : wanting) {
+            vk::DeviceSize growth = entry->source.level(entry->base - 1).size();
+            if (uploaded + growth > uploadPerUpdate && uploaded > 0) {
+                break;
+            }
+            if (resident + growth > budget) {
+                continue;
+            }
+            rebase(*entry, entry->base - 1, cmd);
+            changed.push_back(id);
+            uploaded += growth;
+        }
+
+        // Demand is re-established by the next frame's requests
+        for (auto& [id, entry] : entries) {
+            entry.wanted = entry.tail;
+        }
+        frame++;
+
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        return changed;
+    }
+
+    vk::ImageView TextureStreamer::view(Id id) const {
+        return *entries.at(id).image.view;
+    }
+
+    uint32_t TextureStreamer::residentLevel(Id id) const {
+        return entries.at(id).base;
+    }
+
+    void TextureStreamer::rebase(Entry& entry, uint32_t newBase, vk::CommandBuffer cmd) {
+        const Source& source = entry.source;
+        const uint32_t oldBase = entry.base;
+        const bool hadImage = oldBase < source.levelCount;
+        const uint32_t levels = source.levelCount - newBase;
+        auto extent = [&](uint32_t level) {
+            return vk::Extent3D{ std::max(source.width >> level, 1u), std::max(source.height >> level, 1u), 1 };
+        };
+
+        // Image holding exactly the new resident range
+        Resident next;
+        vk::ImageCreateInfo imageInfo(
+            {}, vk::ImageType::e2D, source.format,
+            extent(newBase),
+            levels, 1, vk::SampleCountFlagBits::e1,
+            vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
+        );
+        next.image = ctx.device->createImageUnique(imageInfo).value;
+
+        vk::MemoryRequirements memRequirements = ctx.device->getImageMemoryRequirements(*next.image);
+        vk::MemoryAllocateInfo allocInfo(
+            memRequirements.size,
+            findMemoryType(ctx.physicalDevice, memRequirements.memoryTypeBits,
+                vk::MemoryPropertyFlagBits::eDeviceLocal)
+        );
+        next.memory = ctx.device->allocateMemoryUnique(allocInfo).value;
+        ctx.device->bindImageMemory(*next.image, *next.memory, 0);
+
+        std::vector<vk::ImageMemoryBarrier> barriers;
+        barriers.emplace_back(
+            vk::AccessFlags{}, vk::AccessFlagBits::eTransferWrite,
+            vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+            *next.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1));
+        if (hadImage) {
+            barriers.emplace_back(
+                vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferRead,
+                vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                *entry.image.image,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, source.levelCount - oldBase, 0, 1));
+        }
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eFragmentShader,
+            vk::PipelineStageFlagBits::eTransfer,
+            {}, {}, {}, barriers
+        );
+
+        // Levels resident before and after move over on the GPU
+        if (hadImage) {
+            std::vector<vk::ImageCopy> copies;
+            for (uint32_t level = std::max(oldBase, newBase); level < source.levelCount; level++) {
+                copies.emplace_back(
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - oldBase, 0, 1),
+                    vk::Offset3D{ 0, 0, 0 },
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - newBase, 0, 1),
+                    vk::Offset3D{ 0, 0, 0 },
+                    extent(level));
+            }
+            cmd.copyImage(
+                *entry.image.image, vk::ImageLayout::eTransferSrcOptimal,
+                *next.image, vk::ImageLayout::eTransferDstOptimal,
+                copies);
+        }
+
+        // Newly resident levels come from the source; offsets stay 16-byte aligned for
+        // block formats
+        BufferPackage staging;
+        const uint32_t uploadEnd = hadImage ? oldBase : source.levelCount;
+        if (newBase < uploadEnd) {
+            std::vector<vk::BufferImageCopy> regions;
+            vk::DeviceSize stagingSize = 0;
+            for (uint32_t level = newBase; level < uploadEnd; level++) {
+                stagingSize = (stagingSize + 15) & ~vk::DeviceSize(15);
+                regions.emplace_back(
+                    stagingSize, 0, 0,
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - newBase, 0, 1),
+                    vk::Offset3D{ 0, 0, 0 },
+                    extent(level));
+                stagingSize += source.level(level).size();
+            }
+
+            staging = BufferPackage::create(
+                ctx, stagingSize,
+                vk::BufferUsageFlagBits::eTransferSrc,
+                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+            );
+            auto* mapped = static_cast<uint8_t*>(staging.mapped);
+            for (uint32_t level = newBase; level < uploadEnd; level++) {
+                auto data = source.level(level);
+                std::memcpy(mapped + regions[level - newBase].bufferOffset, data.data(), data.size());
+            }
+            cmd.copyBufferToImage(*staging.buffer, *next.image,
+                vk::ImageLayout::eTransferDstOptimal, regions);
+        }
+
+        vk::ImageMemoryBarrier ready(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+            *next.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1));
+        cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eFragmentShader,
+            {}, {}, {}, ready
+        );
+
+        vk::ImageViewCreateInfo viewInfo(
+            {}, *next.image, vk::ImageViewType::e2D, source.format,
+            {}, { vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1 }
+        );
+        next.view = ctx.device->createImageViewUnique(viewInfo).value;
+
+        // Earlier frames may still sample the old image; it and the staging copy go once
+        // they have finished
+        if (hadImage) {
+            resident -= source.bytesFrom(oldBase);
+        }
+        resident += source.bytesFrom(newBase);
+        retired.push_back({ std::move(entry.image), std::move(staging), frame + Context::MAX_FRAMES_IN_FLIGHT });
+        entry.image = std::move(next);
+        entry.base = newBase;
+    }
+} // namespace VulkanCube
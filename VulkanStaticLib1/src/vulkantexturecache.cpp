@@ -0,0 +1,231 @@
+#include "../pch.h"
+#include "../include/vulkantexturecache.hpp"
+#include "../include/vulkanfiles.hpp"
+#include "../include/vulkanhash.hpp"
+#include "../include/vulkanktx2.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace VulkanCube {
+
+    // Entry layout: a fixed header, one {offset, size} pair per level, then the levels,
+    // each starting on a 16-byte boundary. Offsets are from the start of the file.
+    static constexpr uint32_t ENTRY_MAGIC = 0x58544356;    // "VCTX"
+    static constexpr size_t ENTRY_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t) + 4 * sizeof(uint32_t);
+    static constexpr size_t ENTRY_LEVEL_SIZE = 2 * sizeof(uint64_t);
+
+    static vk::DeviceSize alignLevel(vk::DeviceSize offset) {
+        return (offset + 15) & ~vk::DeviceSize(15);
+    }
+
+    template <typename T>
+    static T readField(const std::byte* data, size_t offset) {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    static void writeField(std::vector<std::byte>& out, size_t offset, T value) {
+        std::memcpy(out.data() + offset, &value, sizeof(T));
+    }
+
+    // Staging memory and regions for `levels` stored contiguously in `data`, whose
+    // offsets are relative to the start of `data`
+    static TextureUpload makeUpload(const Context& ctx, vk::Format format,
+        uint32_t width, uint32_t height, std::span<const std::byte> data,
+        std::span<const vk::DeviceSize> offsets) {
+        TextureUpload upload;
+        upload.format = format;
+        upload.width = width;
+        upload.height = height;
+        upload.mipLevels = static_cast<uint32_t>(offsets.size());
+        for (uint32_t level = 0; level < upload.mipLevels; level++) {
+            upload.regions.emplace_back(
+                offsets[level], 0, 0,
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+                vk::Offset3D{ 0, 0, 0 },
+                vk::Extent3D{ std::max(width >> level, 1u), std::max(height >> level, 1u), 1 });
+        }
+
+        upload.staging = BufferPackage::create(
+            ctx, data.size(),
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+        memcpy(upload.staging.mapped, data.data(), data.size());
+        return upload;
+    }
+
+    // Returns an empty upload if the entry is missing, foreign or truncated
+    static TextureUpload loadEntry(const Context& ctx, const std::filesystem::path& entryPath,
+        uint64_t sourceHash) {
+        MappedFile file;
+        try {
+            file = MappedFile::open(entryPath.string());
+        }
+        catch (const std::runtime_error&) {
+            return {};
+        }
+
+        const std::byte* data = file.data();
+        const size_t size = file.size();
+        if (size < ENTRY_HEADER_SIZE ||
+            readField<uint32_t>(data, 0) != ENTRY_MAGIC ||
+            readField<uint32_t>(data, 4) != TextureDiskCache::LOADER_VERSION ||
+            readField<uint64_t>(data, 8) != sourceHash) {
+            return {};
+        }
+
+        auto format = static_cast<vk::Format>(readField<uint32_t>(data, 16));
+        auto width = readField<uint32_t>(data, 20);
+        auto height = readField<uint32_t>(data, 24);
+        auto levelCount = readField<uint32_t>(data, 28);
+        if (format != vk::Format::eR8G8B8A8Srgb ||
+            width == 0 || height == 0 || levelCount == 0 || levelCount > mipLevelCount(width, height) ||
+            (size - ENTRY_HEADER_SIZE) / ENTRY_LEVEL_SIZE < levelCount) {
+            return {};
+        }
+
+        // Levels are contiguous, so the whole chain goes to staging in one copy
+        const size_t dataStart = alignLevel(ENTRY_HEADER_SIZE + levelCount * ENTRY_LEVEL_SIZE);
+        std::vector<vk::DeviceSize> offsets;
+        size_t dataEnd = dataStart;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            size_t entry = ENTRY_HEADER_SIZE + level * ENTRY_LEVEL_SIZE;
+            auto offset = readField<uint64_t>(data, entry);
+            auto length = readField<uint64_t>(data, entry + 8);
+            if (offset < dataEnd || offset % 16 != 0 || offset > size || length > size - offset) {
+                return {};
+            }
+            // Copy regions cover the level's full extent, so a short level would read past it
+            if (length < uint64_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4) {
+                return {};
+            }
+            offsets.push_back(offset - dataStart);
+            dataEnd = static_cast<size_t>(offset + length);
+        }
+
+        return makeUpload(ctx, format, width, height,
+            file.bytes().subspan(dataStart, dataEnd - dataStart), offsets);
+    }
+
+    // Best effort; a half-written entry never becomes visible under its final name
+    static void writeEntry(const std::filesystem::path& entryPath, const std::vector<std::byte>& entry) {
+        std::error_code ec;
+        std::filesystem::create_directories(entryPath.parent_path(), ec);
+
+        // Threads decoding the same source race to publish identical bytes; give each its
+        // own temp file so they never write into one another's
+        auto tempPath = entryPath;
+        tempPath += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return;
+            }
+            file.write(reinterpret_cast<const char*>(entry.data()), entry.size());
+            file.close();
+            if (!file) {
+                std::filesystem::remove(tempPath, ec);
+                return;
+            }
+        }
+
+        std::filesystem::rename(tempPath, entryPath, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+        }
+    }
+
+    TextureDiskCache::TextureDiskCache(std::filesystem::path directory)
+        : directory(std::move(directory)) {
+    }
+
+    TextureUpload TextureDiskCache::load(const Context& ctx, const std::string& path) {
+        MappedFile source = MappedFile::open(path);
+        if (Ktx2File::isKtx2(source.bytes())) {
+            Ktx2File ktx = Ktx2File::parse(std::move(source), path);
+            if (!isTextureFormatSupported(ctx, ktx.format)) {
+                throw std::runtime_error("Texture format not supported by this device: " + path);
+            }
+            return TextureUpload::fromKtx2(ctx, ktx);
+        }
+
+        const uint64_t sourceHash = Hasher()
+            .add(LOADER_VERSION)
+            .bytes(source.data(), source.size())
+            .value();
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.vctex", static_cast<unsigned long long>(sourceHash));
+        const auto entryPath = directory / name;
+
+        TextureUpload cached = loadEntry(ctx, entryPath, sourceHash);
+        if (cached.staging.buffer) {
+            hitCount.fetch_add(1, std::memory_order_relaxed);
+            return cached;
+        }
+        missCount.fetch_add(1, std::memory_order_relaxed);
+
+        int texWidth, texHeight, texChannels;
+        stbi_uc* pixels = stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(source.data()), static_cast<int>(source.size()),
+            &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load texture image: " + path);
+        }
+        const auto width = static_cast<uint32_t>(texWidth);
+        const auto height = static_cast<uint32_t>(texHeight);
+        const uint32_t levelCount = mipLevelCount(width, height);
+
+        // Build the entry in host memory: reading back from staging would mean reading
+        // write-combined memory
+        size_t at = alignLevel(ENTRY_HEADER_SIZE + levelCount * ENTRY_LEVEL_SIZE);
+        const size_t dataStart = at;
+        std::vector<vk::DeviceSize> offsets;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            at = alignLevel(at);
+            offsets.push_back(at);
+            at += size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+        }
+
+        std::vector<std::byte> entry(at);
+        writeField(entry, 0, ENTRY_MAGIC);
+        writeField(entry, 4, LOADER_VERSION);
+        writeField(entry, 8, sourceHash);
+        writeField(entry, 16, static_cast<uint32_t>(vk::Format::eR8G8B8A8Srgb));
+        writeField(entry, 20, width);
+        writeField(entry, 24, height);
+        writeField(entry, 28, levelCount);
+
+        std::memcpy(entry.data() + offsets[0], pixels, size_t(width) * height * 4);
+        stbi_image_free(pixels);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            size_t index = ENTRY_HEADER_SIZE + level * ENTRY_LEVEL_SIZE;
+            size_t length = size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+            writeField<uint64_t>(entry, index, offsets[level]);
+            writeField<uint64_t>(entry, index + 8, length);
+            if (level > 0) {
+                downsampleRGBA8(reinterpret_cast<const uint8_t*>(entry.data() + offsets[level - 1]),
+                    std::max(width >> (level - 1), 1u), std::max(height >> (level - 1), 1u),
+                    reinterpret_cast<uint8_t*>(entry.data() + offsets[level]));
+            }
+        }
+        writeEntry(entryPath, entry);
+
+        for (auto& offset : offsets) {
+            offset -= dataStart;
+        }
+        return makeUpload(ctx, vk::Format::eR8G8B8A8Srgb, width, height,
+            std::span<const std::byte>(entry).subspan(dataStart), offsets);
+    }
+} // namespace VulkanCube
@@ -2,37 +2,136 @@
 #include "../include/vulkantextures.hpp"
 #include "../include/vulkanbuffers.hpp"
 #include "../include/vulkancommands.hpp"
+#include "../include/vulkanfiles.hpp"
+#include "../include/vulkanktx2.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VULKAN_CUBE_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VULKAN_CUBE_NEON
+#endif
+
+// stb_image picks up SSE2 on its own, but its NEON IDCT and YCbCr kernels are opt-in.
+// Requesting 4 channels lets those kernels write RGBA directly, so 3-channel JPEGs need
+// no separate expansion pass.
+#if defined(VULKAN_CUBE_NEON)
+#define STBI_NEON
+#endif
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 namespace VulkanCube {
 
-    Texture Texture::loadFromFile(const Context& ctx, CommandPool& pool, const char* path) {
-        Texture tex;
+    vk::SamplerCreateInfo textureSamplerInfo(const Context& ctx) {
+        return vk::SamplerCreateInfo(
+            {},
+            vk::Filter::eLinear,
+            vk::Filter::eLinear,
+            vk::SamplerMipmapMode::eLinear,
+            vk::SamplerAddressMode::eRepeat,
+            vk::SamplerAddressMode::eRepeat,
+            vk::SamplerAddressMode::eRepeat,
+            0.0f,
+            ctx.deviceFeatures.samplerAnisotropy ? VK_TRUE : VK_FALSE,
+            ctx.deviceFeatures.samplerAnisotropy ?
+            std::min(16.0f, ctx.deviceProperties.limits.maxSamplerAnisotropy) : 1.0f,
+            VK_FALSE,
+            vk::CompareOp::eAlways,
+            0.0f,
+            VK_LOD_CLAMP_NONE,
+            vk::BorderColor::eIntOpaqueBlack,
+            VK_FALSE
+        );
+    }
 
-        // Load image data
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(path, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        vk::DeviceSize imageSize = texWidth * texHeight * 4;
+    bool supportsMipBlits(const Context& ctx, vk::Format format) {
+        vk::FormatFeatureFlags features = ctx.physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+        return (features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) &&
+            (features & vk::FormatFeatureFlagBits::eBlitSrc) &&
+            (features & vk::FormatFeatureFlagBits::eBlitDst);
+    }
 
-        // Create staging buffer
-        BufferPackage staging = BufferPackage::create(
-            ctx, imageSize,
-            vk::BufferUsageFlagBits::eTransferSrc,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-        );
+    uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+        return static_cast<uint32_t>(std::bit_width(std::max({ width, height, 1u })));
+    }
 
-        memcpy(staging.mapped, pixels, static_cast<size_t>(imageSize));
-        stbi_image_free(pixels);
+    // Two destination pixels from a 4x2 block of RGBA8 source; rounds like (a+b+c+d+2)/4
+    static inline void boxFilter2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst) {
+#if defined(VULKAN_CUBE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(sum, sum));
+#elif defined(VULKAN_CUBE_NEON)
+        uint8x16_t a = vld1q_u8(row0);
+        uint8x16_t b = vld1q_u8(row1);
+        uint16x8_t lo = vaddl_u8(vget_low_u8(a), vget_low_u8(b));
+        uint16x8_t hi = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+        uint16x8_t sum = vcombine_u16(
+            vadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+            vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+        vst1_u8(dst, vrshrn_n_u16(sum, 2));
+#else
+        for (int c = 0; c < 8; c++) {
+            int x = (c / 4) * 8 + c % 4;
+            dst[c] = static_cast<uint8_t>((row0[x] + row0[x + 4] + row1[x] + row1[x + 4] + 2) / 4);
+        }
+#endif
+    }
+
+    // Halves an RGBA8 image with a 2x2 box filter. Odd edges clamp, so a 1-pixel-wide
+    // source still averages vertically. Averages the stored values, which for sRGB data
+    // is slightly darker than filtering in linear space, as blit paths do.
+    void downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst) {
+        uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+        uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+        size_t srcStride = size_t(srcWidth) * 4;
+
+        for (uint32_t y = 0; y < dstHeight; y++) {
+            const uint8_t* row0 = src + size_t(2 * y) * srcStride;
+            const uint8_t* row1 = src + size_t(std::min(2 * y + 1, srcHeight - 1)) * srcStride;
+            uint8_t* out = dst + size_t(y) * dstWidth * 4;
+
+            // Vector path needs four whole source pixels per pair of output pixels
+            uint32_t x = 0;
+            if (srcWidth >= 2) {
+                for (; x + 2 <= dstWidth; x += 2) {
+                    boxFilter2(row0 + size_t(x) * 8, row1 + size_t(x) * 8, out + size_t(x) * 4);
+                }
+            }
+            for (; x < dstWidth; x++) {
+                uint32_t x0 = 2 * x;
+                uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+                for (uint32_t c = 0; c < 4; c++) {
+                    out[x * 4 + c] = static_cast<uint8_t>((row0[x0 * 4 + c] + row0[x1 * 4 + c] +
+                        row1[x0 * 4 + c] + row1[x1 * 4 + c] + 2) / 4);
+                }
+            }
+        }
+    }
 
-        // Create image
+    // Device-local image with tex.format, tex.mipLevels levels and tex.layers layers
+    static void allocateImage(const Context& ctx, Texture& tex, uint32_t width, uint32_t height,
+        vk::ImageUsageFlags usage) {
         vk::ImageCreateInfo imageInfo(
-            {}, vk::ImageType::e2D, vk::Format::eR8G8B8A8Srgb,
-            { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 },
-            1, 1, vk::SampleCountFlagBits::e1,
+            {}, vk::ImageType::e2D, tex.format,
+            { width, height, 1 },
+            tex.mipLevels, tex.layers, vk::SampleCountFlagBits::e1,
             vk::ImageTiling::eOptimal,
-            vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
+            usage
         );
         tex.image = ctx.device->createImageUnique(imageInfo).value;
 
@@ -45,78 +144,508 @@ namespace VulkanCube {
         );
         tex.memory = ctx.device->allocateMemoryUnique(allocInfo).value;
         ctx.device->bindImageMemory(*tex.image, *tex.memory, 0);
+    }
+
+    static void createViewAndSampler(const Context& ctx, Texture& tex,
+        vk::ImageViewType viewType = vk::ImageViewType::e2D) {
+        // Create image view
+        vk::ImageViewCreateInfo viewInfo(
+            {}, *tex.image, viewType, tex.format,
+            {}, { vk::ImageAspectFlagBits::eColor, 0, tex.mipLevels, 0, tex.layers }
+        );
+        tex.view = ctx.device->createImageViewUnique(viewInfo).value;
+
+        // Every texture shares the one sampler for this state
+        tex.sampler = ctx.samplerCache->get(textureSamplerInfo(ctx));
+    }
+
+    // Host copy is a CPU write into device memory; past this size one GPU copy from staging
+    // finishes sooner
+    static constexpr vk::DeviceSize HOST_COPY_MAX_BYTES = 16ull << 20;
+
+    static bool preferHostCopy(const Context& ctx, vk::Format format, vk::DeviceSize bytes) {
+        return bytes <= HOST_COPY_MAX_BYTES && Texture::supportsHostCopy(ctx, format);
+    }
+
+    // Full RGBA8 mip chain in host memory; `levels` points into the returned storage
+    static std::vector<uint8_t> buildMipChain(const uint8_t* rgba, uint32_t width, uint32_t height,
+        std::vector<std::span<const std::byte>>& levels) {
+        const uint32_t levelCount = mipLevelCount(width, height);
+        std::vector<size_t> offsets;
+        size_t size = 0;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            offsets.push_back(size);
+            size += size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+        }
+
+        std::vector<uint8_t> chain(size);
+        memcpy(chain.data(), rgba, size_t(width) * height * 4);
+        for (uint32_t level = 1; level < levelCount; level++) {
+            downsampleRGBA8(chain.data() + offsets[level - 1],
+                std::max(width >> (level - 1), 1u), std::max(height >> (level - 1), 1u),
+                chain.data() + offsets[level]);
+        }
+
+        levels.clear();
+        for (uint32_t level = 0; level < levelCount; level++) {
+            size_t end = level + 1 < levelCount ? offsets[level + 1] : size;
+            levels.emplace_back(reinterpret_cast<const std::byte*>(chain.data()) + offsets[level],
+                end - offsets[level]);
+        }
+        return chain;
+    }
+
+    // Loads `path` with host image copy when the device supports it for this texture;
+    // empty means the caller should go through staging instead
+    static std::optional<Texture> loadWithHostCopy(const Context& ctx, const std::string& path) {
+        if (!ctx.hostImageCopy) {
+            return std::nullopt;
+        }
+
+        // Size and format come from the headers, so a staging fallback never decodes twice
+        MappedFile file = MappedFile::open(path);
+        if (Ktx2File::isKtx2(file.bytes())) {
+            Ktx2File ktx = Ktx2File::parse(std::move(file), path);
+            vk::DeviceSize bytes = 0;
+            for (const auto& level : ktx.levels) {
+                bytes += level.length;
+            }
+            if (!isTextureFormatSupported(ctx, ktx.format) || !preferHostCopy(ctx, ktx.format, bytes)) {
+                return std::nullopt;
+            }
+            std::vector<std::span<const std::byte>> levels;
+            for (uint32_t level = 0; level < ktx.levels.size(); level++) {
+                levels.push_back(ktx.levelData(level));
+            }
+            return Texture::createWithHostCopy(ctx, ktx.format, ktx.width, ktx.height, levels);
+        }
+
+        int texWidth, texHeight, texChannels;
+        if (!stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+                &texWidth, &texHeight, &texChannels) ||
+            !preferHostCopy(ctx, vk::Format::eR8G8B8A8Srgb, vk::DeviceSize(texWidth) * texHeight * 4)) {
+            return std::nullopt;
+        }
+
+        stbi_uc* pixels = stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+            &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load texture image: " + path);
+        }
+        const auto width = static_cast<uint32_t>(texWidth);
+        const auto height = static_cast<uint32_t>(texHeight);
+        std::vector<std::span<const std::byte>> levels;
+        std::vector<uint8_t> chain;
+        try {
+            chain = buildMipChain(pixels, width, height, levels);
+        }
+        catch (...) {
+            stbi_image_free(pixels);
+            throw;
+        }
+        stbi_image_free(pixels);
+        return Texture::createWithHostCopy(ctx, vk::Format::eR8G8B8A8Srgb, width, height, levels);
+    }
+
+    TextureUpload TextureUpload::fromFile(const Context& ctx, const std::string& path) {
+        // Decode straight from the mapped file instead of through stb's buffered reads
+        MappedFile file = MappedFile::open(path);
+        if (Ktx2File::isKtx2(file.bytes())) {
+            Ktx2File ktx = Ktx2File::parse(std::move(file), path);
+            if (!isTextureFormatSupported(ctx, ktx.format)) {
+                throw std::runtime_error("Texture format not supported by this device: " + path);
+            }
+            return fromKtx2(ctx, ktx);
+        }
+
+        int texWidth, texHeight, texChannels;
+        stbi_uc* pixels = stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(file.data()), static_cast<int>(file.size()),
+            &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load texture image: " + path);
+        }
+
+        TextureUpload upload;
+        try {
+            upload = fromPixels(ctx, pixels,
+                static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+        }
+        catch (...) {
+            stbi_image_free(pixels);
+            throw;
+        }
+        stbi_image_free(pixels);
+        return upload;
+    }
+
+    TextureUpload TextureUpload::fromPixels(const Context& ctx,
+        const uint8_t* rgba, uint32_t width, uint32_t height) {
+        TextureUpload upload;
+        upload.format = vk::Format::eR8G8B8A8Srgb;
+        upload.width = width;
+        upload.height = height;
+        upload.mipLevels = mipLevelCount(width, height);
+
+        // Without linear blits the CPU builds every level and they go up in one copy
+        upload.blitMips = upload.mipLevels > 1 && supportsMipBlits(ctx, upload.format);
+        const uint32_t uploadLevels = upload.blitMips ? 1 : upload.mipLevels;
+
+        // Staging layout: level 0 followed by each CPU-generated level
+        vk::DeviceSize stagingSize = 0;
+        for (uint32_t level = 0; level < uploadLevels; level++) {
+            uint32_t w = std::max(width >> level, 1u);
+            uint32_t h = std::max(height >> level, 1u);
+            upload.regions.emplace_back(
+                stagingSize, 0, 0,
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+                vk::Offset3D{ 0, 0, 0 },
+                vk::Extent3D{ w, h, 1 });
+            stagingSize += vk::DeviceSize(w) * h * 4;
+        }
+
+        // Create staging buffer
+        upload.staging = BufferPackage::create(
+            ctx, stagingSize,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+
+        auto* mapped = static_cast<uint8_t*>(upload.staging.mapped);
+        const size_t baseSize = size_t(width) * height * 4;
+        memcpy(mapped, rgba, baseSize);
+        if (uploadLevels > 1) {
+            // Each level is filtered from the one before, so build them in host memory and
+            // copy once; staging is often write-combined and very slow to read back
+            std::vector<uint8_t> chain(stagingSize - baseSize);
+            const uint8_t* src = rgba;
+            for (uint32_t level = 1; level < uploadLevels; level++) {
+                uint8_t* dst = chain.data() + (upload.regions[level].bufferOffset - baseSize);
+                downsampleRGBA8(src, std::max(width >> (level - 1), 1u), std::max(height >> (level - 1), 1u), dst);
+                src = dst;
+            }
+            memcpy(mapped + baseSize, chain.data(), chain.size());
+        }
+        return upload;
+    }
+
+    TextureUpload TextureUpload::fromKtx2(const Context& ctx, const Ktx2File& ktx) {
+        TextureUpload upload;
+        upload.format = ktx.format;
+        upload.width = ktx.width;
+        upload.height = ktx.height;
+        upload.mipLevels = static_cast<uint32_t>(ktx.levels.size());
+
+        // Levels go up exactly as stored; offsets are kept 16-byte aligned, which covers
+        // every block size and the 4-byte copy alignment
+        vk::DeviceSize stagingSize = 0;
+        for (uint32_t level = 0; level < upload.mipLevels; level++) {
+            stagingSize = (stagingSize + 15) & ~vk::DeviceSize(15);
+            upload.regions.emplace_back(
+                stagingSize, 0, 0,
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+                vk::Offset3D{ 0, 0, 0 },
+                vk::Extent3D{ std::max(ktx.width >> level, 1u), std::max(ktx.height >> level, 1u), 1 });
+            stagingSize += ktx.levels[level].length;
+        }
+
+        upload.staging = BufferPackage::create(
+            ctx, stagingSize,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+        auto* mapped = static_cast<uint8_t*>(upload.staging.mapped);
+        for (uint32_t level = 0; level < upload.mipLevels; level++) {
+            auto data = ktx.levelData(level);
+            memcpy(mapped + upload.regions[level].bufferOffset, data.data(), data.size());
+        }
+        return upload;
+    }
+
+    Texture Texture::loadFromFile(const Context& ctx, CommandPool& pool, const char* path) {
+        if (auto tex = loadWithHostCopy(ctx, path)) {
+            return std::move(*tex);
+        }
+        return createFromUpload(ctx, pool, TextureUpload::fromFile(ctx, path));
+    }
+
+    Texture Texture::createFromPixels(const Context& ctx, CommandPool& pool,
+        const uint8_t* rgba, uint32_t width, uint32_t height) {
+        return createFromUpload(ctx, pool, TextureUpload::fromPixels(ctx, rgba, width, height));
+    }
+
+    Texture Texture::createFromKtx2(const Context& ctx, CommandPool& pool, const Ktx2File& ktx) {
+        // Host copy reads the levels straight out of the file mapping
+        vk::DeviceSize bytes = 0;
+        for (const auto& level : ktx.levels) {
+            bytes += level.length;
+        }
+        if (preferHostCopy(ctx, ktx.format, bytes)) {
+            std::vector<std::span<const std::byte>> levels;
+            for (uint32_t level = 0; level < ktx.levels.size(); level++) {
+                levels.push_back(ktx.levelData(level));
+            }
+            return createWithHostCopy(ctx, ktx.format, ktx.width, ktx.height, levels);
+        }
+        return createFromUpload(ctx, pool, TextureUpload::fromKtx2(ctx, ktx));
+    }
 
-        // Transition image layout
+    bool Texture::supportsHostCopy(const Context& ctx, vk::Format format) {
+        if (!ctx.hostImageCopy) {
+            return false;
+        }
+        auto properties = ctx.physicalDevice.getFormatProperties2<vk::FormatProperties2, vk::FormatProperties3>(format);
+        auto features = properties.get<vk::FormatProperties3>().optimalTilingFeatures;
+        if (!(features & vk::FormatFeatureFlagBits2::eHostImageTransferEXT) ||
+            !(features & vk::FormatFeatureFlagBits2::eSampledImage)) {
+            return false;
+        }
+
+        // Host transfer usage may cost the image its compression or optimal layout for
+        // good; staging is the better deal then, however many uploads it saves
+        vk::PhysicalDeviceImageFormatInfo2 imageInfo(format, vk::ImageType::e2D, vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eHostTransferEXT | vk::ImageUsageFlagBits::eSampled);
+        auto imageProperties = ctx.physicalDevice.getImageFormatProperties2<
+            vk::ImageFormatProperties2, vk::HostImageCopyDevicePerformanceQueryEXT>(imageInfo);
+        return imageProperties.result == vk::Result::eSuccess &&
+            imageProperties.value.get<vk::HostImageCopyDevicePerformanceQueryEXT>().optimalDeviceAccess;
+    }
+
+    Texture Texture::createWithHostCopy(const Context& ctx, vk::Format format,
+        uint32_t width, uint32_t height, std::span<const std::span<const std::byte>> levels) {
+        Texture tex;
+        tex.format = format;
+        tex.mipLevels = static_cast<uint32_t>(levels.size());
+        allocateImage(ctx, tex, width, height,
+            vk::ImageUsageFlagBits::eHostTransferEXT | vk::ImageUsageFlagBits::eSampled);
+
+        // Straight to the sampled layout on the host; no command buffer sees this image
+        // before it is complete
+        vk::HostImageLayoutTransitionInfoEXT transition(
+            *tex.image, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, tex.mipLevels, 0, 1));
+        auto result = static_cast<vk::Result>(ctx.transitionImageLayoutEXT(*ctx.device, 1,
+            reinterpret_cast<const VkHostImageLayoutTransitionInfoEXT*>(&transition)));
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to transition texture image on the host!");
+        }
+
+        std::vector<vk::MemoryToImageCopyEXT> regions;
+        for (uint32_t level = 0; level < tex.mipLevels; level++) {
+            regions.emplace_back(
+                levels[level].data(), 0, 0,
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+                vk::Offset3D{ 0, 0, 0 },
+                vk::Extent3D{ std::max(width >> level, 1u), std::max(height >> level, 1u), 1 });
+        }
+        vk::CopyMemoryToImageInfoEXT copyInfo({}, *tex.image, vk::ImageLayout::eShaderReadOnlyOptimal, regions);
+        result = static_cast<vk::Result>(ctx.copyMemoryToImageEXT(*ctx.device,
+            reinterpret_cast<const VkCopyMemoryToImageInfoEXT*>(&copyInfo)));
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to copy texture data on the host!");
+        }
+
+        createViewAndSampler(ctx, tex);
+        return tex;
+    }
+
+    Texture Texture::createFromUpload(const Context& ctx, CommandPool& pool, const TextureUpload& upload) {
+        // Waits for the copy so the caller can drop the staging memory right away
         auto cmdBuffer = beginSingleTimeCommands(ctx, pool);
+        Texture tex = recordUpload(ctx, *cmdBuffer, upload);
+        endSingleTimeCommands(ctx, pool, cmdBuffer.get());
+        return tex;
+    }
 
+    Texture Texture::recordUpload(const Context& ctx, vk::CommandBuffer cmdBuffer, const TextureUpload& upload) {
+        Texture tex;
+        tex.format = upload.format;
+        tex.mipLevels = upload.mipLevels;
+        tex.layers = upload.layers;
+
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+        if (upload.blitMips) {
+            usage |= vk::ImageUsageFlagBits::eTransferSrc;
+        }
+        allocateImage(ctx, tex, upload.width, upload.height, usage);
+
+        // Transition every level for the upload
         vk::ImageMemoryBarrier barrier(
             {}, vk::AccessFlagBits::eTransferWrite,
             vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
             VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
             *tex.image,
             vk::ImageSubresourceRange(
-                vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1
+                vk::ImageAspectFlagBits::eColor, 0, tex.mipLevels, 0, tex.layers
             )
         );
-        cmdBuffer->pipelineBarrier(
+        cmdBuffer.pipelineBarrier(
             vk::PipelineStageFlagBits::eTopOfPipe,
             vk::PipelineStageFlagBits::eTransfer,
             {}, {}, {}, barrier
         );
 
         // Copy buffer to image
-        vk::BufferImageCopy region(
-            0, 0, 0,
-            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
-            { 0, 0, 0 },
-            { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1 }
-        );
-        cmdBuffer->copyBufferToImage(*staging.buffer, *tex.image,
-            vk::ImageLayout::eTransferDstOptimal, 1, &region);
+        cmdBuffer.copyBufferToImage(*upload.staging.buffer, *tex.image,
+            vk::ImageLayout::eTransferDstOptimal, upload.regions);
 
-        // Transition to shader read layout
+        // Each level is blitted from the one above it, which then becomes shader-readable
+        barrier.subresourceRange.levelCount = 1;
+        int32_t mipWidth = static_cast<int32_t>(upload.width);
+        int32_t mipHeight = static_cast<int32_t>(upload.height);
+        for (uint32_t level = 1; upload.blitMips && level < tex.mipLevels; level++) {
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+            barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+            barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+            cmdBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eTransfer,
+                {}, {}, {}, barrier
+            );
+
+            int32_t nextWidth = std::max(mipWidth / 2, 1);
+            int32_t nextHeight = std::max(mipHeight / 2, 1);
+            vk::ImageBlit blit(
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - 1, 0, tex.layers),
+                { vk::Offset3D{ 0, 0, 0 }, vk::Offset3D{ mipWidth, mipHeight, 1 } },
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, tex.layers),
+                { vk::Offset3D{ 0, 0, 0 }, vk::Offset3D{ nextWidth, nextHeight, 1 } }
+            );
+            cmdBuffer.blitImage(
+                *tex.image, vk::ImageLayout::eTransferSrcOptimal,
+                *tex.image, vk::ImageLayout::eTransferDstOptimal,
+                blit, vk::Filter::eLinear
+            );
+
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+            barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+            barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            cmdBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eFragmentShader,
+                {}, {}, {}, barrier
+            );
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+
+        // Transition to shader read layout: the last blitted level, or every uploaded one
+        barrier.subresourceRange.baseMipLevel = upload.blitMips ? tex.mipLevels - 1 : 0;
+        barrier.subresourceRange.levelCount = upload.blitMips ? 1 : tex.mipLevels;
         barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
         barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
         barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
         barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
-        cmdBuffer->pipelineBarrier(
+        cmdBuffer.pipelineBarrier(
             vk::PipelineStageFlagBits::eTransfer,
             vk::PipelineStageFlagBits::eFragmentShader,
             {}, {}, {}, barrier
         );
 
-        endSingleTimeCommands(ctx, pool, cmdBuffer.get());
+        createViewAndSampler(ctx, tex, upload.viewType);
+        return tex;
+    }
 
-        // Create image view
-        vk::ImageViewCreateInfo viewInfo(
-            {}, *tex.image, vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Srgb,
-            {}, { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
-        );
-        tex.view = ctx.device->createImageViewUnique(viewInfo).value;
+    Texture Texture::loadFirstSupported(const Context& ctx, CommandPool& pool,
+        std::span<const std::string> candidates) {
+        for (const auto& path : candidates) {
+            // Variants need not all ship; a candidate that cannot be opened is skipped. Only
+            // the header is touched here; the mapping pages level data in on upload.
+            MappedFile file;
+            try {
+                file = MappedFile::open(path);
+            }
+            catch (const std::exception&) {
+                continue;
+            }
+            if (!Ktx2File::isKtx2(file.bytes())) {
+                return loadFromFile(ctx, pool, path.c_str());
+            }
+            Ktx2File ktx = Ktx2File::parse(std::move(file), path);
+            if (isTextureFormatSupported(ctx, ktx.format)) {
+                return createFromKtx2(ctx, pool, ktx);
+            }
+        }
+        throw std::runtime_error("No texture candidate exists in a format this device supports");
+    }
 
-        // Create sampler with proper validation and device limits consideration
-        vk::SamplerCreateInfo samplerInfo(
-            {},
-            vk::Filter::eLinear,
-            vk::Filter::eLinear,
-            vk::SamplerMipmapMode::eLinear,
-            vk::SamplerAddressMode::eRepeat,
-            vk::SamplerAddressMode::eRepeat,
-            vk::SamplerAddressMode::eRepeat,
-            0.0f,
-            ctx.deviceFeatures.samplerAnisotropy ? VK_TRUE : VK_FALSE,
-            ctx.deviceFeatures.samplerAnisotropy ?
-            std::min(16.0f, ctx.deviceProperties.limits.maxSamplerAnisotropy) : 1.0f,
-            VK_FALSE,
-            vk::CompareOp::eAlways,
-            0.0f,
-            VK_LOD_CLAMP_NONE,
-            vk::BorderColor::eIntOpaqueBlack,
-            VK_FALSE
-        );
+    std::vector<Texture> Texture::loadBatch(const Context& ctx, CommandPool& pool,
+        WorkerPool& workers, std::span<const std::string> paths) {
+        struct Slot {
+            std::optional<Texture> texture;     // Already written by host image copy
+            std::optional<TextureUpload> upload;
+            std::exception_ptr error;
+        };
+        std::vector<Slot> slots(paths.size());
+        std::vector<size_t> decoded;
+        std::mutex mutex;
+        std::condition_variable decodedChanged;
 
-        tex.sampler = ctx.device->createSamplerUnique(samplerInfo).value;
-        return tex;
+        // Decode and fill staging memory on the workers, or write the image outright with
+        // host image copy; each finished slot is queued for the render thread, which
+        // records uploads while the remaining decodes run
+        for (size_t i = 0; i < paths.size(); i++) {
+            workers.submit([&, i] {
+                try {
+                    slots[i].texture = loadWithHostCopy(ctx, paths[i]);
+                    if (!slots[i].texture) {
+                        slots[i].upload = TextureUpload::fromFile(ctx, paths[i]);
+                    }
+                }
+                catch (...) {
+                    slots[i].error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.push_back(i);
+                decodedChanged.notify_one();
+            });
+        }
+
+        // Every job references locals of this call, so keep draining until all have
+        // reported back, even after a failure
+        std::vector<Texture> textures(paths.size());
+        std::exception_ptr failure;
+        for (size_t finished = 0; finished < paths.size();) {
+            std::vector<size_t> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                decodedChanged.wait(lock, [&] { return !decoded.empty(); });
+                batch.swap(decoded);
+            }
+            finished += batch.size();
+
+            try {
+                if (!failure) {
+                    auto cmdBuffer = beginSingleTimeCommands(ctx, pool);
+                    for (size_t i : batch) {
+                        if (slots[i].error) {
+                            std::rethrow_exception(slots[i].error);
+                        }
+                        textures[i] = slots[i].texture ? std::move(*slots[i].texture)
+                            : recordUpload(ctx, *cmdBuffer, *slots[i].upload);
+                    }
+                    endSingleTimeCommands(ctx, pool, cmdBuffer.get());
+                }
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+
+            // The batch's copies have completed (or were never submitted); free its staging
+            for (size_t i : batch) {
+                slots[i].upload.reset();
+            }
+        }
+
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+        return textures;
     }
-} // namespace VulkanCube
\ No newline at end of file
+} // namespace VulkanCube
@@ -0,0 +1,69 @@
+#include "../pch.h"
+#include "../include/vulkanworkers.hpp"
+
+namespace VulkanCube {
+
+    WorkerPool::WorkerPool(uint32_t threadCount) {
+        // Leave one core for the render thread
+        if (threadCount == 0) {
+            unsigned cores = std::thread::hardware_concurrency();
+            threadCount = cores > 1 ? cores - 1 : 1;
+        }
+
+        threads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            threads.emplace_back([this] { run(); });
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobAvailable.notify_all();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        jobAvailable.notify_one();
+    }
+
+    void WorkerPool::waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+    }
+
+    void WorkerPool::run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                activeJobs++;
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                activeJobs--;
+                if (jobs.empty() && activeJobs == 0) {
+                    idle.notify_all();
+                }
+            }
+        }
+    }
+} // namespace VulkanCube
@@ -158,7 +158,7 @@ namespace VulkanCube {
         vk::UniqueImage textureImage;
         vk::UniqueDeviceMemory textureImageMemory;
         vk::UniqueImageView textureImageView;
-        vk::UniqueSampler textureSampler;
+        vk::UniqueSampler textureSampler;  // Shared by every descriptor set; samplers are a scarce device resource
 
         // Command pool and buffers
         vk::UniqueCommandPool commandPool;
@@ -175,7 +175,6 @@ namespace VulkanCube {
         std::vector<vk::UniqueFramebuffer> framebuffers;
         vk::ClearValue clearValue;  // Clear value for rendering
 
-        std::vector<vk::UniqueSampler> textureSamplers; // Texture samplers for each image
         std::vector<vk::UniqueBuffer> uniformBuffers;   // Uniform buffers for each frame
         std::vector<vk::UniqueImageView> textureImageViews;
 
@@ -736,12 +735,10 @@ namespace VulkanCube {
 
             vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList);
 
-            vk::Viewport viewport(0.0f, 0.0f,
-                static_cast<float>(swapChainExtent.width),
-                static_cast<float>(swapChainExtent.height),
-                0.0f, 1.0f);
-            vk::Rect2D scissor({ 0, 0 }, swapChainExtent);
-            vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
+            // Viewport and scissor are recorded per command buffer, so resizing keeps this pipeline
+            vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);
+            std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+            vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates);
 
             vk::PipelineRasterizationStateCreateInfo rasterizer({}, VK_FALSE, VK_FALSE, vk::PolygonMode::eFill,
                 vk::CullModeFlagBits::eBack, vk::FrontFace::eClockwise);
@@ -770,7 +767,7 @@ namespace VulkanCube {
             vk::GraphicsPipelineCreateInfo pipelineInfo(
                 {}, 2, shaderStages, &vertexInputInfo, &inputAssembly,
                 nullptr, &viewportState, &rasterizer, &multisampling,
-                nullptr, &colorBlending, nullptr,
+                nullptr, &colorBlending, &dynamicState,
                 *pipelineLayout, *renderPass);
 
             // Creating graphics pipeline with the unique device
@@ -866,6 +863,11 @@ namespace VulkanCube {
 
                 commandBuffers[i]->beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
                 commandBuffers[i]->bindPipeline(vk::PipelineBindPoint::eGraphics, *graphicsPipeline);
+                commandBuffers[i]->setViewport(0, vk::Viewport(0.0f, 0.0f,
+                    static_cast<float>(swapChainExtent.width),
+                    static_cast<float>(swapChainExtent.height),
+                    0.0f, 1.0f));
+                commandBuffers[i]->setScissor(0, vk::Rect2D({ 0, 0 }, swapChainExtent));
                 commandBuffers[i]->bindVertexBuffers(0, { *vertexBuffer }, { 0 });
                 commandBuffers[i]->bindIndexBuffer(*indexBuffer, 0, vk::IndexType::eUint16);
                 commandBuffers[i]->bindDescriptorSets(
@@ -1281,26 +1283,6 @@ namespace VulkanCube {
             memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
         }
 
-        // Texture PLURAL samplers
-        void createTextureSamplers() {
-            textureSamplers.resize(swapChainImages.size());
-
-            // Create texture samplers for each image (this is an example, adjust as needed)
-            for (size_t i = 0; i < swapChainImages.size(); i++) {
-                vk::SamplerCreateInfo samplerInfo({}, vk::Filter::eLinear, vk::Filter::eLinear,
-                    vk::SamplerMipmapMode::eLinear, vk::SamplerAddressMode::eRepeat,
-                    vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat,
-                    0.0f, VK_FALSE, 16.0f, VK_FALSE, vk::CompareOp::eNever,
-                    0.0f, 0.0f, vk::BorderColor::eIntOpaqueBlack, VK_FALSE);
-
-                auto result = device->createSamplerUnique(samplerInfo);
-                if (result.result != vk::Result::eSuccess) {
-                    throw std::runtime_error("Failed to create texture sampler!");
-                }
-                textureSamplers[i] = std::move(result.value);  // Move ownership
-            }
-        }
-
         // Example function to create image views for textures
         void createTextureImageViews() {
             textureImageViews.resize(textures.size());  // Assuming textures is a vector of vk::UniqueImage objects
@@ -1360,6 +1342,8 @@ namespace VulkanCube {
 
         // Descriptor Pool and Descriptor Set Allocation
         void createDescriptorPool() {
+            // Sized exactly on purpose: one fixed set per swapchain image, rebuilt with the
+            // swapchain. This sample does not link VulkanStaticLib1's DescriptorAllocator.
             std::array<vk::DescriptorPoolSize, 2> poolSizes{};
 
             // Pool size for uniform buffer descriptors
@@ -1368,9 +1352,9 @@ namespace VulkanCube {
             // Pool size for combined image sampler descriptors
             poolSizes[1] = { vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(swapChainImages.size()) };
 
-            // Create DescriptorPoolCreateInfo with explicit casting
+            // The sets are UniqueDescriptorSets, whose destructors free them individually
             vk::DescriptorPoolCreateInfo poolInfo(
-                vk::DescriptorPoolCreateFlags(0),     // No special flags
+                vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
                 static_cast<uint32_t>(swapChainImages.size()), // Max sets
                 static_cast<uint32_t>(poolSizes.size()),        // Number of pool sizes
                 poolSizes.data()                       // Pointer to pool sizes
@@ -1562,15 +1546,21 @@ namespace VulkanCube {
 
             device->waitIdle();
 
+            vk::Format oldFormat = swapChainImageFormat;
             cleanupSwapChain();
 
             createSwapChain();
             createImageViews();
-            createRenderPass();      // Recreate render pass
-            createGraphicsPipeline();// Recreate pipeline
+
+            // Viewport and scissor are dynamic, so only a surface format change invalidates these
+            if (swapChainImageFormat != oldFormat) {
+                createRenderPass();
+                createGraphicsPipeline();
+            }
             createDepthResources();
             createFramebuffers();
             createUniformBuffers();  // Recreate uniform buffers
+            descriptorSets.clear();  // Free the old sets while their pool still exists
             createDescriptorPool();  // Recreate descriptor pool
             createDescriptorSets();
             createCommandBuffers();
@@ -1631,6 +1621,7 @@ namespace VulkanCube {
             textureImage.reset();
             uniformBuffer.reset();
             uniformBufferMemory.reset();
+            descriptorSets.clear();
             descriptorPool.reset();
             descriptorSetLayout.reset();
             pipelineLayout.reset();